@@ -42,6 +42,7 @@
 #include "tb-jmp-cache.h"
 #include "tb-hash.h"
 #include "tb-context.h"
+#include "tcg-cpu-stats.h"
 #include "internal.h"
 
 /* -icount align implementation. */
@@ -267,6 +268,7 @@ static inline TranslationBlock *tb_lookup(CPUState *cpu, target_ulong pc,
                    tb_cflags(tb) == cflags)) {
             return tb;
         }
+        qatomic_set(&jc->htable_lookup_count, jc->htable_lookup_count + 1);
         tb = tb_htable_lookup(cpu, pc, cs_base, flags, cflags);
         if (tb == NULL) {
             return NULL;
@@ -286,6 +288,7 @@ static inline TranslationBlock *tb_lookup(CPUState *cpu, target_ulong pc,
                    tb_cflags(tb) == cflags)) {
             return tb;
         }
+        qatomic_set(&jc->htable_lookup_count, jc->htable_lookup_count + 1);
         tb = tb_htable_lookup(cpu, pc, cs_base, flags, cflags);
         if (tb == NULL) {
             return NULL;
@@ -411,10 +414,12 @@ static inline bool check_for_breakpoints(CPUState *cpu, target_ulong pc,
 const void *HELPER(lookup_tb_ptr)(CPUArchState *env)
 {
     CPUState *cpu = env_cpu(env);
+    CPUJumpCache *jc = cpu->tb_jmp_cache;
     TranslationBlock *tb;
     target_ulong cs_base, pc;
     uint32_t flags, cflags;
 
+    qatomic_set(&jc->lookup_tb_ptr_count, jc->lookup_tb_ptr_count + 1);
     cpu_get_tb_cpu_state(env, &pc, &cs_base, &flags);
 
     cflags = curr_cflags(cpu);
@@ -424,6 +429,8 @@ const void *HELPER(lookup_tb_ptr)(CPUArchState *env)
 
     tb = tb_lookup(cpu, pc, cs_base, flags, cflags);
     if (tb == NULL) {
+        qatomic_set(&jc->lookup_tb_ptr_miss_count,
+                    jc->lookup_tb_ptr_miss_count + 1);
         return tcg_code_gen_epilogue;
     }
 
@@ -912,6 +919,7 @@ static inline void cpu_loop_exec_tb(CPUState *cpu, TranslationBlock *tb,
     /* Instruction counter expired.  */
     assert(icount_enabled());
 #ifndef CONFIG_USER_ONLY
+    tcg_cpu_stats_inc(&cpu->tcg_stats->icount_refill_count);
     /* Ensure global icount has gone forward */
     icount_update(cpu);
     /* Refill decrementer and continue execution.  */
@@ -951,6 +959,12 @@ cpu_exec_loop(CPUState *cpu, SyncClocks *sc)
 
             cpu_get_tb_cpu_state(cpu->env_ptr, &pc, &cs_base, &flags);
 
+#ifdef CONFIG_SOFTMMU
+            if (unlikely(qatomic_read(&cpu->tcg_stats->sample_pending))) {
+                tcg_profile_sample(cpu, pc);
+            }
+#endif
+
             /*
              * When requested, use an exact setting for cflags for the next
              * execution.  This is used for icount, precise smc, and stop-
@@ -1043,6 +1057,14 @@ static int cpu_exec_setjmp(CPUState *cpu, SyncClocks *sc)
     return cpu_exec_loop(cpu, sc);
 }
 
+static int cpu_exec_account_exit(CPUState *cpu, int ret)
+{
+    if (ret >= EXCP_INTERRUPT && ret <= EXCP_ATOMIC) {
+        tcg_cpu_stats_inc(&cpu->tcg_stats->exit_count[ret - EXCP_INTERRUPT]);
+    }
+    return ret;
+}
+
 int cpu_exec(CPUState *cpu)
 {
     int ret;
@@ -1052,7 +1074,7 @@ int cpu_exec(CPUState *cpu)
     current_cpu = cpu;
 
     if (cpu_handle_halt(cpu)) {
-        return EXCP_HALTED;
+        return cpu_exec_account_exit(cpu, EXCP_HALTED);
     }
 
     rcu_read_lock();
@@ -1071,7 +1093,7 @@ int cpu_exec(CPUState *cpu)
     cpu_exec_exit(cpu);
     rcu_read_unlock();
 
-    return ret;
+    return cpu_exec_account_exit(cpu, ret);
 }
 
 void tcg_exec_realizefn(CPUState *cpu, Error **errp)
@@ -1085,6 +1107,7 @@ void tcg_exec_realizefn(CPUState *cpu, Error **errp)
     }
 
     cpu->tb_jmp_cache = g_new0(CPUJumpCache, 1);
+    cpu->tcg_stats = g_new0(TCGCPUStats, 1);
     tlb_init(cpu);
 #ifndef CONFIG_USER_ONLY
     tcg_iommu_init_notifier_list(cpu);
@@ -1100,5 +1123,7 @@ void tcg_exec_unrealizefn(CPUState *cpu)
 #endif /* !CONFIG_USER_ONLY */
 
     tlb_destroy(cpu);
+    g_free(cpu->tcg_stats);
+    cpu->tcg_stats = NULL;
     g_free_rcu(cpu->tb_jmp_cache, rcu);
 }
@@ -36,6 +36,7 @@
 #include "trace.h"
 #include "tb-hash.h"
 #include "internal.h"
+#include "tcg-cpu-stats.h"
 #ifdef CONFIG_PLUGIN
 #include "qemu/plugin-memory.h"
 #endif
@@ -231,8 +232,7 @@ static void tlb_mmu_resize_locked(CPUTLBDesc *desc, CPUTLBDescFast *fast,
 static void tlb_mmu_flush_locked(CPUTLBDesc *desc, CPUTLBDescFast *fast)
 {
     desc->n_used_entries = 0;
-    desc->large_page_addr = -1;
-    desc->large_page_mask = -1;
+    memset(desc->large_page, -1, sizeof(desc->large_page));
     desc->vindex = 0;
     memset(fast->table, -1, sizeof_tlb(fast));
     memset(desc->vtable, -1, sizeof(desc->vtable));
@@ -320,10 +320,11 @@ static void flush_all_helper(CPUState *src, run_on_cpu_func fn,
     }
 }
 
-void tlb_flush_counts(size_t *pfull, size_t *ppart, size_t *pelide)
+void tlb_flush_counts(size_t *pfull, size_t *ppart, size_t *pelide,
+                      size_t *plarge)
 {
     CPUState *cpu;
-    size_t full = 0, part = 0, elide = 0;
+    size_t full = 0, part = 0, elide = 0, large = 0;
 
     CPU_FOREACH(cpu) {
         CPUArchState *env = cpu->env_ptr;
@@ -331,10 +332,27 @@ void tlb_flush_counts(size_t *pfull, size_t *ppart, size_t *pelide)
         full += qatomic_read(&env_tlb(env)->c.full_flush_count);
         part += qatomic_read(&env_tlb(env)->c.part_flush_count);
         elide += qatomic_read(&env_tlb(env)->c.elide_flush_count);
+        large += qatomic_read(&env_tlb(env)->c.large_flush_count);
     }
     *pfull = full;
     *ppart = part;
     *pelide = elide;
+    *plarge = large;
+}
+
+void tlb_victim_counts(size_t *phit, size_t *pmiss)
+{
+    CPUState *cpu;
+    size_t hit = 0, miss = 0;
+
+    CPU_FOREACH(cpu) {
+        CPUArchState *env = cpu->env_ptr;
+
+        hit += qatomic_read(&env_tlb(env)->c.vtlb_hit_count);
+        miss += qatomic_read(&env_tlb(env)->c.vtlb_miss_count);
+    }
+    *phit = hit;
+    *pmiss = miss;
 }
 
 static void tlb_flush_by_mmuidx_async_work(CPUState *cpu, run_on_cpu_data data)
@@ -491,24 +509,68 @@ static inline void tlb_flush_vtlb_page_locked(CPUArchState *env, int mmu_idx,
     tlb_flush_vtlb_page_mask_locked(env, mmu_idx, page, -1);
 }
 
+/**
+ * tlb_flush_large_page_locked:
+ * @env: cpu state
+ * @midx: mmu index
+ * @lp: large page region of @midx to flush
+ *
+ * Flush every entry of @midx which lies within @lp, then release @lp.
+ * Each page of a large page is cached as its own TARGET_PAGE_SIZE entry,
+ * so either probe every page of the region or scan the whole table,
+ * whichever touches fewer entries.  Called with tlb_c.lock held.
+ */
+static void tlb_flush_large_page_locked(CPUArchState *env, int midx,
+                                        CPUTLBLargePage *lp)
+{
+    CPUTLBDescFast *f = &env_tlb(env)->f[midx];
+    target_ulong n_pages = (~lp->mask >> TARGET_PAGE_BITS) + 1;
+    size_t n_entries = tlb_n_entries(f);
+
+    tlb_debug("flushing large page midx %d ("
+              TARGET_FMT_lx "/" TARGET_FMT_lx ")\n",
+              midx, lp->addr, lp->mask);
+
+    if (n_pages <= n_entries) {
+        for (target_ulong i = 0; i < n_pages; i++) {
+            target_ulong page = lp->addr + (i << TARGET_PAGE_BITS);
+
+            if (tlb_flush_entry_locked(tlb_entry(env, midx, page), page)) {
+                tlb_n_used_entries_dec(env, midx);
+            }
+        }
+    } else {
+        for (size_t i = 0; i < n_entries; i++) {
+            if (tlb_flush_entry_mask_locked(&f->table[i],
+                                            lp->addr, lp->mask)) {
+                tlb_n_used_entries_dec(env, midx);
+            }
+        }
+    }
+    tlb_flush_vtlb_page_mask_locked(env, midx, lp->addr, lp->mask);
+
+    lp->addr = -1;
+    lp->mask = -1;
+    qatomic_set(&env_tlb(env)->c.large_flush_count,
+                env_tlb(env)->c.large_flush_count + 1);
+}
+
 static void tlb_flush_page_locked(CPUArchState *env, int midx,
                                   target_ulong page)
 {
-    target_ulong lp_addr = env_tlb(env)->d[midx].large_page_addr;
-    target_ulong lp_mask = env_tlb(env)->d[midx].large_page_mask;
+    CPUTLBLargePage *lp = env_tlb(env)->d[midx].large_page;
 
     /* Check if we need to flush due to large pages.  */
-    if ((page & lp_mask) == lp_addr) {
-        tlb_debug("forcing full flush midx %d ("
-                  TARGET_FMT_lx "/" TARGET_FMT_lx ")\n",
-                  midx, lp_addr, lp_mask);
-        tlb_flush_one_mmuidx_locked(env, midx, get_clock_realtime());
-    } else {
-        if (tlb_flush_entry_locked(tlb_entry(env, midx, page), page)) {
-            tlb_n_used_entries_dec(env, midx);
+    for (int i = 0; i < CPU_TLB_LARGE_PAGES; i++) {
+        if ((page & lp[i].mask) == lp[i].addr) {
+            tlb_flush_large_page_locked(env, midx, &lp[i]);
         }
-        tlb_flush_vtlb_page_locked(env, midx, page);
     }
+
+    if (tlb_flush_entry_locked(tlb_entry(env, midx, page), page)) {
+        tlb_n_used_entries_dec(env, midx);
+    }
+    tlb_flush_vtlb_page_locked(env, midx, page);
 }
 
 /**
@@ -714,7 +776,7 @@ static void tlb_flush_range_locked(CPUArchState *env, int midx,
                                    target_ulong addr, target_ulong len,
                                    unsigned bits)
 {
-    CPUTLBDesc *d = &env_tlb(env)->d[midx];
+    CPUTLBLargePage *lp = env_tlb(env)->d[midx].large_page;
     CPUTLBDescFast *f = &env_tlb(env)->f[midx];
     target_ulong mask = MAKE_64BIT_MASK(0, bits);
 
@@ -736,17 +798,14 @@ static void tlb_flush_range_locked(CPUArchState *env, int midx,
         return;
     }
 
-    /*
-     * Check if we need to flush due to large pages.
-     * Because large_page_mask contains all 1's from the msb,
-     * we only need to test the end of the range.
-     */
-    if (((addr + len - 1) & d->large_page_mask) == d->large_page_addr) {
-        tlb_debug("forcing full flush midx %d ("
-                  TARGET_FMT_lx "/" TARGET_FMT_lx ")\n",
-                  midx, d->large_page_addr, d->large_page_mask);
-        tlb_flush_one_mmuidx_locked(env, midx, get_clock_realtime());
-        return;
+    /* Check if we need to flush due to large pages.  */
+    for (int i = 0; i < CPU_TLB_LARGE_PAGES; i++) {
+        target_ulong lp_last = lp[i].addr | ~lp[i].mask;
+
+        if (lp[i].addr != (target_ulong)-1 &&
+            addr <= lp_last && addr + len - 1 >= lp[i].addr) {
+            tlb_flush_large_page_locked(env, midx, &lp[i]);
+        }
     }
 
     for (target_ulong i = 0; i < len; i += TARGET_PAGE_SIZE) {
@@ -1081,28 +1140,50 @@ void tlb_set_dirty(CPUState *cpu, target_ulong vaddr)
     qemu_spin_unlock(&env_tlb(env)->c.lock);
 }
 
-/* Our TLB does not support large pages, so remember the area covered by
-   large pages and trigger a full TLB flush if these are invalidated.  */
+/* Our TLB does not support large pages, so remember the areas covered by
+   large pages and flush the whole area if any page of it is invalidated.  */
 static void tlb_add_large_page(CPUArchState *env, int mmu_idx,
                                target_ulong vaddr, target_ulong size)
 {
-    target_ulong lp_addr = env_tlb(env)->d[mmu_idx].large_page_addr;
+    CPUTLBLargePage *lp = env_tlb(env)->d[mmu_idx].large_page;
     target_ulong lp_mask = ~(size - 1);
+    target_ulong best_mask = 0;
+    int i, best = 0, unused = -1;
+
+    for (i = 0; i < CPU_TLB_LARGE_PAGES; i++) {
+        target_ulong mask;
 
-    if (lp_addr == (target_ulong)-1) {
-        /* No previous large page.  */
-        lp_addr = vaddr;
+        if (lp[i].addr == (target_ulong)-1) {
+            if (unused < 0) {
+                unused = i;
+            }
+            continue;
+        }
+        mask = lp[i].mask & lp_mask;
+        while (((lp[i].addr ^ vaddr) & mask) != 0) {
+            mask <<= 1;
+        }
+        if (mask == lp[i].mask) {
+            /* Already covered by this region.  */
+            return;
+        }
+        /* The largest mask gives the smallest merged region.  */
+        if (mask > best_mask) {
+            best_mask = mask;
+            best = i;
+        }
+    }
+
+    if (unused >= 0) {
+        lp[unused].addr = vaddr & lp_mask;
+        lp[unused].mask = lp_mask;
     } else {
-        /* Extend the existing region to include the new page.
+        /* Extend the closest region to include the new page.
            This is a compromise between unnecessary flushes and
            the cost of maintaining a full variable size TLB.  */
-        lp_mask &= env_tlb(env)->d[mmu_idx].large_page_mask;
-        while (((lp_addr ^ vaddr) & lp_mask) != 0) {
-            lp_mask <<= 1;
-        }
+        lp[best].addr &= best_mask;
+        lp[best].mask = best_mask;
     }
-    env_tlb(env)->d[mmu_idx].large_page_addr = lp_addr & lp_mask;
-    env_tlb(env)->d[mmu_idx].large_page_mask = lp_mask;
 }
 
 /*
@@ -1317,6 +1398,8 @@ static void tlb_fill(CPUState *cpu, target_ulong addr, int size,
 {
     bool ok;
 
+    tcg_cpu_stats_inc(&cpu->tcg_stats->tlb_fill_count);
+
     /*
      * This is not a probe, so only valid return is success; failure
      * should result in exception + longjmp to the cpu loop.
@@ -1359,6 +1442,7 @@ static uint64_t io_readx(CPUArchState *env, CPUTLBEntryFull *full,
     hwaddr mr_offset;
     MemoryRegionSection *section;
     MemoryRegion *mr;
+    bool locked = false;
     uint64_t val;
     MemTxResult r;
 
@@ -1370,9 +1454,13 @@ static uint64_t io_readx(CPUArchState *env, CPUTLBEntryFull *full,
         cpu_io_recompile(cpu, retaddr);
     }
 
-    {
-        QEMU_IOTHREAD_LOCK_GUARD();
-        r = memory_region_dispatch_read(mr, mr_offset, &val, op, full->attrs);
+    if (mr->global_locking && !qemu_mutex_iothread_locked()) {
+        qemu_mutex_lock_iothread();
+        locked = true;
+    }
+    r = memory_region_dispatch_read(mr, mr_offset, &val, op, full->attrs);
+    if (locked) {
+        qemu_mutex_unlock_iothread();
     }
 
     if (r != MEMTX_OK) {
@@ -1409,6 +1497,7 @@ static void io_writex(CPUArchState *env, CPUTLBEntryFull *full,
     hwaddr mr_offset;
     MemoryRegionSection *section;
     MemoryRegion *mr;
+    bool locked = false;
     MemTxResult r;
 
     section = iotlb_to_section(cpu, full->xlat_section, full->attrs);
@@ -1425,9 +1514,13 @@ static void io_writex(CPUArchState *env, CPUTLBEntryFull *full,
      */
     save_iotlb_data(cpu, section, mr_offset);
 
-    {
-        QEMU_IOTHREAD_LOCK_GUARD();
-        r = memory_region_dispatch_write(mr, mr_offset, val, op, full->attrs);
+    if (mr->global_locking && !qemu_mutex_iothread_locked()) {
+        qemu_mutex_lock_iothread();
+        locked = true;
+    }
+    r = memory_region_dispatch_write(mr, mr_offset, val, op, full->attrs);
+    if (locked) {
+        qemu_mutex_unlock_iothread();
     }
 
     if (r != MEMTX_OK) {
@@ -1456,10 +1549,20 @@ static inline target_ulong tlb_read_ofs(CPUTLBEntry *entry, size_t ofs)
 static bool victim_tlb_hit(CPUArchState *env, size_t mmu_idx, size_t index,
                            size_t elt_ofs, target_ulong page)
 {
-    size_t vidx;
+    CPUTLBCommon *c = &env_tlb(env)->c;
+    size_t vindex = env_tlb(env)->d[mmu_idx].vindex;
+    size_t i;
 
     assert_cpu_is_self(env_cpu(env));
-    for (vidx = 0; vidx < CPU_VTLB_SIZE; ++vidx) {
+    /*
+     * Victims are inserted round-robin at vindex.  Scan from the most
+     * recently evicted entry backwards: an entry that was just pushed
+     * out of the direct-mapped table by a conflicting page is the one
+     * most likely to be wanted again.
+     */
+    QEMU_BUILD_BUG_ON(CPU_VTLB_SIZE & (CPU_VTLB_SIZE - 1));
+    for (i = 0; i < CPU_VTLB_SIZE; ++i) {
+        size_t vidx = (vindex - 1 - i) % CPU_VTLB_SIZE;
         CPUTLBEntry *vtlb = &env_tlb(env)->d[mmu_idx].vtable[vidx];
         target_ulong cmp;
 
@@ -1484,9 +1587,11 @@ static bool victim_tlb_hit(CPUArchState *env, size_t mmu_idx, size_t index,
             CPUTLBEntryFull *f2 = &env_tlb(env)->d[mmu_idx].vfulltlb[vidx];
             CPUTLBEntryFull tmpf;
             tmpf = *f1; *f1 = *f2; *f2 = tmpf;
+            qatomic_set(&c->vtlb_hit_count, c->vtlb_hit_count + 1);
             return true;
         }
     }
+    qatomic_set(&c->vtlb_miss_count, c->vtlb_miss_count + 1);
     return false;
 }
 
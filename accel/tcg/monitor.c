@@ -10,11 +10,21 @@
 #include "qapi/error.h"
 #include "qapi/type-helpers.h"
 #include "qapi/qapi-commands-machine.h"
+#include "qapi/qapi-types-stats.h"
+#include "qapi/qmp/qdict.h"
+#include "qapi/qmp/qerror.h"
 #include "monitor/monitor.h"
+#include "monitor/hmp.h"
+#include "exec/cputlb.h"
 #include "sysemu/cpus.h"
 #include "sysemu/cpu-timers.h"
+#include "sysemu/stats.h"
 #include "sysemu/tcg.h"
+#include "tcg/tcg.h"
 #include "internal.h"
+#include "tb-context.h"
+#include "tb-jmp-cache.h"
+#include "tcg-cpu-stats.h"
 
 
 static void dump_drift_info(GString *buf)
@@ -97,10 +107,216 @@ HumanReadableText *qmp_x_query_profile(Error **errp)
 }
 #endif
 
+/*
+ * query-stats support.  All counters are cumulative and are read without
+ * stopping the vCPUs, so a snapshot may be slightly inconsistent.
+ */
+typedef struct TCGStatDesc {
+    const char *name;
+    StatsUnit unit;
+    bool has_unit;
+} TCGStatDesc;
+
+static const TCGStatDesc tcg_vm_stats[] = {
+    { "tb-flushes" },
+    { "tb-invalidates" },
+    { "code-buffer-used", STATS_UNIT_BYTES, true },
+};
+
+static const char * const tcg_exit_names[TCG_EXIT_REASONS] = {
+    [EXCP_INTERRUPT - EXCP_INTERRUPT] = "exits-interrupt",
+    [EXCP_HLT - EXCP_INTERRUPT] = "exits-hlt",
+    [EXCP_DEBUG - EXCP_INTERRUPT] = "exits-debug",
+    [EXCP_HALTED - EXCP_INTERRUPT] = "exits-halted",
+    [EXCP_YIELD - EXCP_INTERRUPT] = "exits-yield",
+    [EXCP_ATOMIC - EXCP_INTERRUPT] = "exits-atomic",
+};
+
+static const TCGStatDesc tcg_vcpu_stats[] = {
+    { "tbs-translated" },
+    { "tb-code-bytes", STATS_UNIT_BYTES, true },
+    { "tb-lookups" },
+    { "tb-lookup-misses" },
+    { "tlb-fills" },
+    { "tlb-full-flushes" },
+    { "tlb-partial-flushes" },
+    { "tlb-victim-hits" },
+    { "tlb-victim-misses" },
+    { "icount-refills" },
+};
+
+static StatsList *tcg_stats_add(StatsList *list, strList *names,
+                                const char *name, uint64_t val)
+{
+    Stats *stats;
+
+    if (!apply_str_list_filter(name, names)) {
+        return list;
+    }
+
+    stats = g_new0(Stats, 1);
+    stats->name = g_strdup(name);
+    stats->value = g_new0(StatsValue, 1);
+    stats->value->type = QTYPE_QNUM;
+    stats->value->u.scalar = val;
+
+    QAPI_LIST_PREPEND(list, stats);
+    return list;
+}
+
+static StatsList *tcg_stats_vm(strList *names)
+{
+    StatsList *list = NULL;
+
+    list = tcg_stats_add(list, names, "tb-flushes",
+                         qatomic_read(&tb_ctx.tb_flush_count));
+    list = tcg_stats_add(list, names, "tb-invalidates",
+                         qatomic_read(&tb_ctx.tb_phys_invalidate_count));
+    list = tcg_stats_add(list, names, "code-buffer-used", tcg_code_size());
+    return list;
+}
+
+static StatsList *tcg_stats_vcpu(CPUState *cpu, strList *names)
+{
+    CPUTLBCommon *c = &env_tlb(cpu->env_ptr)->c;
+    CPUJumpCache *jc = cpu->tb_jmp_cache;
+    TCGCPUStats *st = cpu->tcg_stats;
+    StatsList *list = NULL;
+    int i;
+
+    list = tcg_stats_add(list, names, "tbs-translated",
+                         qatomic_read(&st->tb_count));
+    list = tcg_stats_add(list, names, "tb-code-bytes",
+                         qatomic_read(&st->tb_code_bytes));
+    list = tcg_stats_add(list, names, "tb-lookups",
+                         qatomic_read(&jc->lookup_tb_ptr_count));
+    list = tcg_stats_add(list, names, "tb-lookup-misses",
+                         qatomic_read(&jc->lookup_tb_ptr_miss_count));
+    list = tcg_stats_add(list, names, "tlb-fills",
+                         qatomic_read(&st->tlb_fill_count));
+    list = tcg_stats_add(list, names, "tlb-full-flushes",
+                         qatomic_read(&c->full_flush_count));
+    list = tcg_stats_add(list, names, "tlb-partial-flushes",
+                         qatomic_read(&c->part_flush_count));
+    list = tcg_stats_add(list, names, "tlb-victim-hits",
+                         qatomic_read(&c->vtlb_hit_count));
+    list = tcg_stats_add(list, names, "tlb-victim-misses",
+                         qatomic_read(&c->vtlb_miss_count));
+    list = tcg_stats_add(list, names, "icount-refills",
+                         qatomic_read(&st->icount_refill_count));
+    for (i = 0; i < TCG_EXIT_REASONS; i++) {
+        list = tcg_stats_add(list, names, tcg_exit_names[i],
+                             qatomic_read(&st->exit_count[i]));
+    }
+    return list;
+}
+
+static void tcg_query_stats_cb(StatsResultList **result, StatsTarget target,
+                               strList *names, strList *targets,
+                               Error **errp)
+{
+    StatsList *list;
+    CPUState *cpu;
+
+    if (!tcg_enabled()) {
+        return;
+    }
+
+    /* like the KVM provider, do not report entries with no statistics */
+    switch (target) {
+    case STATS_TARGET_VM:
+        list = tcg_stats_vm(names);
+        if (list) {
+            add_stats_entry(result, STATS_PROVIDER_TCG, NULL, list);
+        }
+        break;
+    case STATS_TARGET_VCPU:
+        CPU_FOREACH(cpu) {
+            if (!cpu->tcg_stats || !cpu->tb_jmp_cache) {
+                continue;
+            }
+            if (!apply_str_list_filter(cpu->parent_obj.canonical_path,
+                                       targets)) {
+                continue;
+            }
+            list = tcg_stats_vcpu(cpu, names);
+            if (list) {
+                add_stats_entry(result, STATS_PROVIDER_TCG,
+                                cpu->parent_obj.canonical_path, list);
+            }
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+static StatsSchemaValueList *tcg_schemas_add(StatsSchemaValueList *list,
+                                             const TCGStatDesc *desc)
+{
+    StatsSchemaValue *value = g_new0(StatsSchemaValue, 1);
+
+    value->name = g_strdup(desc->name);
+    value->type = STATS_TYPE_CUMULATIVE;
+    value->has_unit = desc->has_unit;
+    value->unit = desc->unit;
+
+    QAPI_LIST_PREPEND(list, value);
+    return list;
+}
+
+static void tcg_query_stats_schemas_cb(StatsSchemaList **result,
+                                       Error **errp)
+{
+    StatsSchemaValueList *list;
+    int i;
+
+    if (!tcg_enabled()) {
+        return;
+    }
+
+    list = NULL;
+    for (i = 0; i < ARRAY_SIZE(tcg_vm_stats); i++) {
+        list = tcg_schemas_add(list, &tcg_vm_stats[i]);
+    }
+    add_stats_schema(result, STATS_PROVIDER_TCG, STATS_TARGET_VM, list);
+
+    list = NULL;
+    for (i = 0; i < ARRAY_SIZE(tcg_vcpu_stats); i++) {
+        list = tcg_schemas_add(list, &tcg_vcpu_stats[i]);
+    }
+    for (i = 0; i < TCG_EXIT_REASONS; i++) {
+        TCGStatDesc desc = { tcg_exit_names[i] };
+        list = tcg_schemas_add(list, &desc);
+    }
+    add_stats_schema(result, STATS_PROVIDER_TCG, STATS_TARGET_VCPU, list);
+}
+
+void hmp_tcg_profile(Monitor *mon, const QDict *qdict)
+{
+    const char *op = qdict_get_str(qdict, "op");
+    bool has_period = qdict_haskey(qdict, "period");
+    uint32_t period = qdict_get_try_int(qdict, "period", 0);
+    Error *err = NULL;
+
+    if (!strcmp(op, "start")) {
+        /* the 'i' argument type already rejects values above 32 bits */
+        qmp_x_tcg_profile_start(has_period, period, &err);
+    } else if (!strcmp(op, "stop")) {
+        qmp_x_tcg_profile_stop(&err);
+    } else {
+        error_setg(&err, QERR_INVALID_PARAMETER, op);
+    }
+    hmp_handle_error(mon, err);
+}
+
 static void hmp_tcg_register(void)
 {
     monitor_register_hmp_info_hrt("jit", qmp_x_query_jit);
     monitor_register_hmp_info_hrt("opcount", qmp_x_query_opcount);
+    monitor_register_hmp_info_hrt("tcg-profile", qmp_x_query_tcg_profile);
+    add_stats_callbacks(STATS_PROVIDER_TCG, tcg_query_stats_cb,
+                        tcg_query_stats_schemas_cb);
 }
 
 type_init(hmp_tcg_register);
@@ -0,0 +1,170 @@
+/*
+ * Built-in sampling profiler for guest code
+ *
+ * A realtime timer periodically asks every running vCPU to leave its
+ * chain of translation blocks; the vCPU then records the guest PC of the
+ * TB it is about to execute.  Samples therefore approximate the host time
+ * spent in each guest code region, without needing perf on the host.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "qemu/osdep.h"
+#include "qemu/thread.h"
+#include "qemu/timer.h"
+#include "qapi/error.h"
+#include "qapi/type-helpers.h"
+#include "qapi/qapi-commands-machine.h"
+#include "disas/disas.h"
+#include "hw/core/cpu.h"
+#include "sysemu/tcg.h"
+#include "internal.h"
+#include "tcg-cpu-stats.h"
+
+#define TCG_PROFILE_DEFAULT_PERIOD_US 1000
+
+typedef struct TCGProfile {
+    QEMUTimer *timer;
+    uint32_t period_us;
+    /* Protects hist, which is updated by the vCPU threads. */
+    QemuMutex lock;
+    /* guest PC (uint64_t *) -> number of samples (size_t *) */
+    GHashTable *hist;
+} TCGProfile;
+
+static TCGProfile profile;
+
+static void tcg_profile_tick(void *opaque)
+{
+    CPUState *cpu;
+
+    CPU_FOREACH(cpu) {
+        if (!cpu->tcg_stats || !qatomic_read(&cpu->running)) {
+            continue;
+        }
+        /*
+         * Like cpu_exit(), but without exit_request: the vCPU only goes
+         * as far as cpu_handle_interrupt() and then resumes execution.
+         */
+        qatomic_set(&cpu->tcg_stats->sample_pending, true);
+        smp_wmb();
+        qatomic_set(&cpu_neg(cpu)->icount_decr.u16.high, -1);
+    }
+
+    timer_mod(profile.timer,
+              qemu_clock_get_us(QEMU_CLOCK_REALTIME) + profile.period_us);
+}
+
+void tcg_profile_sample(CPUState *cpu, target_ulong pc)
+{
+    uint64_t key = pc;
+    size_t *count;
+
+    qatomic_set(&cpu->tcg_stats->sample_pending, false);
+
+    qemu_mutex_lock(&profile.lock);
+    count = g_hash_table_lookup(profile.hist, &key);
+    if (!count) {
+        count = g_new0(size_t, 1);
+        g_hash_table_insert(profile.hist, g_memdup2(&key, sizeof(key)),
+                            count);
+    }
+    (*count)++;
+    qemu_mutex_unlock(&profile.lock);
+}
+
+void qmp_x_tcg_profile_start(bool has_period, uint32_t period, Error **errp)
+{
+    if (!tcg_enabled()) {
+        error_setg(errp, "The profiler is only available with accel=tcg");
+        return;
+    }
+    if (has_period && period == 0) {
+        error_setg(errp, "Parameter 'period' must be greater than 0");
+        return;
+    }
+
+    if (!profile.hist) {
+        qemu_mutex_init(&profile.lock);
+        profile.hist = g_hash_table_new_full(g_int64_hash, g_int64_equal,
+                                             g_free, g_free);
+        profile.timer = timer_new_us(QEMU_CLOCK_REALTIME,
+                                     tcg_profile_tick, NULL);
+    }
+
+    qemu_mutex_lock(&profile.lock);
+    g_hash_table_remove_all(profile.hist);
+    qemu_mutex_unlock(&profile.lock);
+
+    profile.period_us = has_period ? period : TCG_PROFILE_DEFAULT_PERIOD_US;
+    timer_mod(profile.timer,
+              qemu_clock_get_us(QEMU_CLOCK_REALTIME) + profile.period_us);
+}
+
+void qmp_x_tcg_profile_stop(Error **errp)
+{
+    if (profile.timer) {
+        timer_del(profile.timer);
+    }
+}
+
+static gint tcg_profile_cmp(gconstpointer a, gconstpointer b, gpointer data)
+{
+    GHashTable *folded = data;
+    size_t ca = GPOINTER_TO_SIZE(g_hash_table_lookup(folded, a));
+    size_t cb = GPOINTER_TO_SIZE(g_hash_table_lookup(folded, b));
+
+    return ca < cb ? 1 : ca > cb ? -1 : strcmp(a, b);
+}
+
+/*
+ * Emit the samples in the folded-stack format understood by
+ * flamegraph.pl: one "frame count" line per guest symbol, or per
+ * guest PC when no symbol covers it.
+ */
+HumanReadableText *qmp_x_query_tcg_profile(Error **errp)
+{
+    g_autoptr(GString) buf = g_string_new("");
+    g_autoptr(GHashTable) folded = NULL;
+    g_autoptr(GList) names = NULL;
+    GHashTableIter iter;
+    gpointer key, value;
+    GList *l;
+
+    if (!profile.hist) {
+        error_setg(errp, "The profiler has not been started");
+        return NULL;
+    }
+
+    folded = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+
+    qemu_mutex_lock(&profile.lock);
+    g_hash_table_iter_init(&iter, profile.hist);
+    while (g_hash_table_iter_next(&iter, &key, &value)) {
+        uint64_t pc = *(uint64_t *)key;
+        const char *sym = lookup_symbol(pc);
+        char *name;
+        gpointer old;
+
+        if (sym[0] != '\0') {
+            name = g_strdup(sym);
+        } else {
+            name = g_strdup_printf("0x%" PRIx64, pc);
+        }
+        old = g_hash_table_lookup(folded, name);
+        g_hash_table_replace(folded, name,
+                             GSIZE_TO_POINTER(GPOINTER_TO_SIZE(old) +
+                                              *(size_t *)value));
+    }
+    qemu_mutex_unlock(&profile.lock);
+
+    names = g_list_sort_with_data(g_hash_table_get_keys(folded),
+                                  tcg_profile_cmp, folded);
+    for (l = names; l; l = l->next) {
+        g_string_append_printf(buf, "%s %zu\n", (char *)l->data,
+                               GPOINTER_TO_SIZE(
+                                   g_hash_table_lookup(folded, l->data)));
+    }
+
+    return human_readable_text_from_str(buf);
+}
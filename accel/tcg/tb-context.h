@@ -26,6 +26,9 @@
 #define CODE_GEN_HTABLE_BITS     15
 #define CODE_GEN_HTABLE_SIZE     (1 << CODE_GEN_HTABLE_BITS)
 
+/* tb_flush() latency buckets: <10us, <100us, <1ms, <10ms, <100ms, more */
+#define TB_FLUSH_HIST_BUCKETS    6
+
 typedef struct TBContext TBContext;
 
 struct TBContext {
@@ -35,6 +38,10 @@ struct TBContext {
     /* statistics */
     unsigned tb_flush_count;
     unsigned tb_phys_invalidate_count;
+    /* time spent in tb_flush(), updated under mmap_lock */
+    size_t tb_flush_time_us;
+    unsigned tb_flush_time_max_us;
+    unsigned tb_flush_time_hist[TB_FLUSH_HIST_BUCKETS];
 };
 
 extern TBContext tb_ctx;
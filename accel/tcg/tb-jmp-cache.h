@@ -19,6 +19,13 @@
  */
 struct CPUJumpCache {
     struct rcu_head rcu;
+    /*
+     * Statistics, only written by the owning vCPU and read atomically
+     * by the monitor.  Not cleared by tcg_flush_jmp_cache().
+     */
+    size_t lookup_tb_ptr_count;
+    size_t lookup_tb_ptr_miss_count;
+    size_t htable_lookup_count;
     struct {
         TranslationBlock *tb;
         target_ulong pc;
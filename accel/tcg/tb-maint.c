@@ -20,6 +20,7 @@
 #include "qemu/osdep.h"
 #include "qemu/interval-tree.h"
 #include "qemu/qtree.h"
+#include "qemu/timer.h"
 #include "exec/cputlb.h"
 #include "exec/log.h"
 #include "exec/exec-all.h"
@@ -192,8 +193,28 @@ struct PageDesc {
     QemuSpin lock;
     /* list of TBs intersecting this ram page */
     uintptr_t first_tb;
+    /*
+     * Superset of the bytes covered by the TBs in first_tb, one bit per
+     * 1/64th of the page.  Set under @lock, but read locklessly so that
+     * writes next to code can skip invalidation.
+     */
+    uint64_t code_bitmap;
 };
 
+#define CODE_BITMAP_SHIFT  (TARGET_PAGE_BITS - 6)
+
+/* Return the code_bitmap bits for [@start, @last], within one page. */
+static inline uint64_t code_bitmap_range(tb_page_addr_t start,
+                                         tb_page_addr_t last)
+{
+    unsigned first = (start & ~TARGET_PAGE_MASK) >> CODE_BITMAP_SHIFT;
+    unsigned final = (last & ~TARGET_PAGE_MASK) >> CODE_BITMAP_SHIFT;
+
+    tcg_debug_assert((start & TARGET_PAGE_MASK) == (last & TARGET_PAGE_MASK));
+    tcg_debug_assert(first <= final);
+    return MAKE_64BIT_MASK(first, final - first + 1);
+}
+
 void page_table_config_init(void)
 {
     uint32_t v_l1_bits;
@@ -581,6 +602,7 @@ static void tb_remove_all_1(int level, void **lp)
         for (i = 0; i < V_L2_SIZE; ++i) {
             page_lock(&pd[i]);
             pd[i].first_tb = (uintptr_t)NULL;
+            qatomic_set(&pd[i].code_bitmap, 0);
             page_unlock(&pd[i]);
         }
     } else {
@@ -601,6 +623,24 @@ static void tb_remove_all(void)
     }
 }
 
+/* Return the bytes [@start, @last] of page @n that @tb covers. */
+static void tb_page_range(const TranslationBlock *tb, unsigned int n,
+                          tb_page_addr_t *start, tb_page_addr_t *last)
+{
+    /* NOTE: this is subtle as a TB may span two physical pages */
+    tb_page_addr_t tb_start = tb_page_addr0(tb);
+    tb_page_addr_t tb_last = tb_start + tb->size - 1;
+
+    if (n == 0) {
+        tb_last = MIN(tb_last, tb_start | ~TARGET_PAGE_MASK);
+    } else {
+        tb_start = tb_page_addr1(tb);
+        tb_last = tb_start + (tb_last & ~TARGET_PAGE_MASK);
+    }
+    *start = tb_start;
+    *last = tb_last;
+}
+
 /*
  * Add the tb in the target page and protect it if necessary.
  * Called with @p->lock held.
@@ -609,9 +649,15 @@ static inline void tb_page_add(PageDesc *p, TranslationBlock *tb,
                                unsigned int n)
 {
     bool page_already_protected;
+    tb_page_addr_t start, last;
 
     assert_page_locked(p);
 
+    tb_page_range(tb, n, &start, &last);
+    /* Published before the TB can be found and executed. */
+    qatomic_set(&p->code_bitmap,
+                p->code_bitmap | code_bitmap_range(start, last));
+
     tb->page_next[n] = p->first_tb;
     page_already_protected = p->first_tb != 0;
     p->first_tb = (uintptr_t)tb | n;
@@ -725,9 +771,30 @@ static void page_unlock_tb(const TranslationBlock *tb)
 }
 #endif /* CONFIG_USER_ONLY */
 
+/* Called with mmap_lock held.  */
+static void tb_flush_account(int64_t start)
+{
+    unsigned us = (get_clock() - start) / SCALE_US;
+    unsigned limit = 10;
+    int bucket = 0;
+
+    while (bucket < TB_FLUSH_HIST_BUCKETS - 1 && us >= limit) {
+        bucket++;
+        limit *= 10;
+    }
+
+    qatomic_set(&tb_ctx.tb_flush_time_us, tb_ctx.tb_flush_time_us + us);
+    if (us > tb_ctx.tb_flush_time_max_us) {
+        qatomic_set(&tb_ctx.tb_flush_time_max_us, us);
+    }
+    qatomic_set(&tb_ctx.tb_flush_time_hist[bucket],
+                tb_ctx.tb_flush_time_hist[bucket] + 1);
+}
+
 /* flush all the translation blocks */
 static void do_tb_flush(CPUState *cpu, run_on_cpu_data tb_flush_count)
 {
+    int64_t start = get_clock();
     bool did_flush = false;
 
     mmap_lock();
@@ -747,6 +814,7 @@ static void do_tb_flush(CPUState *cpu, run_on_cpu_data tb_flush_count)
     tcg_region_reset_all();
     /* XXX: flush processor icache at this point if cache flush is expensive */
     qatomic_mb_set(&tb_ctx.tb_flush_count, tb_ctx.tb_flush_count + 1);
+    tb_flush_account(start);
 
 done:
     mmap_unlock();
@@ -1088,28 +1156,36 @@ tb_invalidate_phys_page_range__locked(struct page_collection *pages,
 {
     TranslationBlock *tb;
     PageForEachNext n;
+    uint64_t code_bitmap = 0;
 #ifdef TARGET_HAS_PRECISE_SMC
     bool current_tb_modified = false;
-    TranslationBlock *current_tb = retaddr ? tcg_tb_lookup(retaddr) : NULL;
+    TranslationBlock *current_tb;
+#endif /* TARGET_HAS_PRECISE_SMC */
+
+    /* Nothing to invalidate if the range only touches data near code. */
+    if (!(p->code_bitmap & code_bitmap_range(start, last))) {
+        if (!p->first_tb) {
+            tlb_unprotect_code(start);
+        }
+        return;
+    }
+
+#ifdef TARGET_HAS_PRECISE_SMC
+    current_tb = retaddr ? tcg_tb_lookup(retaddr) : NULL;
 #endif /* TARGET_HAS_PRECISE_SMC */
 
     /*
-     * We remove all the TBs in the range [start, last].
+     * We remove all the TBs in the range [start, last], and recompute
+     * the code bitmap from the ones that survive.
      * XXX: see if in some cases it could be faster to invalidate all the code
      */
     PAGE_FOR_EACH_TB(start, last, p, tb, n) {
         tb_page_addr_t tb_start, tb_last;
 
-        /* NOTE: this is subtle as a TB may span two physical pages */
-        tb_start = tb_page_addr0(tb);
-        tb_last = tb_start + tb->size - 1;
-        if (n == 0) {
-            tb_last = MIN(tb_last, tb_start | ~TARGET_PAGE_MASK);
+        tb_page_range(tb, n, &tb_start, &tb_last);
+        if (tb_last < start || tb_start > last) {
+            code_bitmap |= code_bitmap_range(tb_start, tb_last);
         } else {
-            tb_start = tb_page_addr1(tb);
-            tb_last = tb_start + (tb_last & ~TARGET_PAGE_MASK);
-        }
-        if (!(tb_last < start || tb_start > last)) {
 #ifdef TARGET_HAS_PRECISE_SMC
             if (current_tb == tb &&
                 (tb_cflags(current_tb) & CF_COUNT_MASK) != 1) {
@@ -1127,6 +1203,7 @@ tb_invalidate_phys_page_range__locked(struct page_collection *pages,
             tb_phys_invalidate__locked(tb);
         }
     }
+    qatomic_set(&p->code_bitmap, code_bitmap);
 
     /* if no code remaining, no need to continue to use slow writes */
     if (!p->first_tb) {
@@ -1183,15 +1260,16 @@ void tb_invalidate_phys_range(tb_page_addr_t start, tb_page_addr_t last)
     index_last = last >> TARGET_PAGE_BITS;
     for (index = start >> TARGET_PAGE_BITS; index <= index_last; index++) {
         PageDesc *pd = page_find(index);
-        tb_page_addr_t bound;
+        tb_page_addr_t page_start, bound;
 
         if (pd == NULL) {
             continue;
         }
         assert_page_locked(pd);
+        page_start = MAX(start, index << TARGET_PAGE_BITS);
         bound = (index << TARGET_PAGE_BITS) | ~TARGET_PAGE_MASK;
         bound = MIN(bound, last);
-        tb_invalidate_phys_page_range__locked(pages, pd, start, bound, 0);
+        tb_invalidate_phys_page_range__locked(pages, pd, page_start, bound, 0);
     }
     page_collection_unlock(pages);
 }
@@ -1224,6 +1302,25 @@ void tb_invalidate_phys_range_fast(ram_addr_t ram_addr,
                                    uintptr_t retaddr)
 {
     struct page_collection *pages;
+    PageDesc *p;
+
+    /*
+     * Avoid taking the page locks for writes that do not overlap any
+     * translated code.  A TB that is being added concurrently publishes
+     * its bits before it can run, and reads guest memory before that,
+     * so it cannot miss this write any more than it could with the lock.
+     * Once the page has no TBs left, take the slow path once more so
+     * that it gets unprotected.
+     */
+    p = page_find(ram_addr >> TARGET_PAGE_BITS);
+    if (!p) {
+        return;
+    }
+    if (!(qatomic_read(&p->code_bitmap) &
+          code_bitmap_range(ram_addr, ram_addr + size - 1)) &&
+        qatomic_read(&p->first_tb)) {
+        return;
+    }
 
     pages = page_collection_lock(ram_addr, ram_addr + size - 1);
     tb_invalidate_phys_page_fast__locked(pages, ram_addr, size, retaddr);
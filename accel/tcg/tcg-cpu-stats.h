@@ -0,0 +1,36 @@
+/*
+ * Per-vCPU TCG execution statistics.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef ACCEL_TCG_TCG_CPU_STATS_H
+#define ACCEL_TCG_TCG_CPU_STATS_H
+
+/* cpu_exec() exits to the main loop with EXCP_INTERRUPT .. EXCP_ATOMIC */
+#define TCG_EXIT_REASONS (EXCP_ATOMIC - EXCP_INTERRUPT + 1)
+
+/*
+ * Only written by the owning vCPU thread; the monitor reads them
+ * atomically without stopping the vCPU.
+ */
+struct TCGCPUStats {
+    /* Returns from cpu_exec(), indexed by EXCP_* - EXCP_INTERRUPT. */
+    size_t exit_count[TCG_EXIT_REASONS];
+    /* icount decrementer expiries refilled without leaving cpu_exec(). */
+    size_t icount_refill_count;
+    /* Translation blocks generated, and host code bytes emitted for them. */
+    size_t tb_count;
+    size_t tb_code_bytes;
+    /* Softmmu slow-path accesses that had to call the target's tlb_fill. */
+    size_t tlb_fill_count;
+    /* Set by the sampling profiler; consumed at the next TB lookup. */
+    bool sample_pending;
+};
+
+static inline void tcg_cpu_stats_inc(size_t *counter)
+{
+    qatomic_set(counter, *counter + 1);
+}
+
+#endif /* ACCEL_TCG_TCG_CPU_STATS_H */
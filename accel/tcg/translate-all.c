@@ -62,6 +62,7 @@
 #include "tb-jmp-cache.h"
 #include "tb-hash.h"
 #include "tb-context.h"
+#include "tcg-cpu-stats.h"
 #include "internal.h"
 #include "perf.h"
 
@@ -407,6 +408,9 @@ TranslationBlock *tb_gen_code(CPUState *cpu,
         goto buffer_overflow;
     }
     tb->tc.size = gen_code_size;
+    tcg_cpu_stats_inc(&cpu->tcg_stats->tb_count);
+    qatomic_set(&cpu->tcg_stats->tb_code_bytes,
+                cpu->tcg_stats->tb_code_bytes + gen_code_size);
 
     /*
      * For CF_PCREL, attribute all executions of the generated code
@@ -703,11 +707,94 @@ static gboolean tb_tree_stats_iter(gpointer key, gpointer value, gpointer data)
     return false;
 }
 
+static void dump_tb_lookup_info(GString *buf)
+{
+    size_t calls = 0, misses = 0, htable = 0;
+    CPUState *cpu;
+
+    CPU_FOREACH(cpu) {
+        CPUJumpCache *jc = cpu->tb_jmp_cache;
+
+        if (jc) {
+            calls += qatomic_read(&jc->lookup_tb_ptr_count);
+            misses += qatomic_read(&jc->lookup_tb_ptr_miss_count);
+            htable += qatomic_read(&jc->htable_lookup_count);
+        }
+    }
+    g_string_append_printf(buf, "lookup_tb_ptr calls %zu (%zu%% not found)\n",
+                           calls, calls ? (misses * 100) / calls : 0);
+    g_string_append_printf(buf, "TB jmp cache misses %zu\n", htable);
+}
+
+static void dump_cpu_exit_info(GString *buf)
+{
+    static const char * const names[TCG_EXIT_REASONS] = {
+        [EXCP_INTERRUPT - EXCP_INTERRUPT] = "interrupt",
+        [EXCP_HLT - EXCP_INTERRUPT] = "hlt",
+        [EXCP_DEBUG - EXCP_INTERRUPT] = "debug",
+        [EXCP_HALTED - EXCP_INTERRUPT] = "halted",
+        [EXCP_YIELD - EXCP_INTERRUPT] = "yield",
+        [EXCP_ATOMIC - EXCP_INTERRUPT] = "atomic",
+    };
+    size_t exits[TCG_EXIT_REASONS] = { };
+    size_t total = 0, refills = 0;
+    CPUState *cpu;
+    int i;
+
+    CPU_FOREACH(cpu) {
+        TCGCPUStats *st = cpu->tcg_stats;
+
+        if (!st) {
+            continue;
+        }
+        for (i = 0; i < TCG_EXIT_REASONS; i++) {
+            exits[i] += qatomic_read(&st->exit_count[i]);
+        }
+        refills += qatomic_read(&st->icount_refill_count);
+    }
+
+    for (i = 0; i < TCG_EXIT_REASONS; i++) {
+        total += exits[i];
+    }
+    g_string_append_printf(buf, "cpu_exec exits      %zu (", total);
+    for (i = 0; i < TCG_EXIT_REASONS; i++) {
+        g_string_append_printf(buf, "%s%s %zu", i ? ", " : "",
+                               names[i], exits[i]);
+    }
+    g_string_append_printf(buf, ")\n");
+    if (icount_enabled()) {
+        g_string_append_printf(buf, "icount refills      %zu\n", refills);
+    }
+}
+
+static void dump_tb_flush_info(GString *buf)
+{
+    static const char * const labels[TB_FLUSH_HIST_BUCKETS] = {
+        "<10us", "<100us", "<1ms", "<10ms", "<100ms", ">=100ms",
+    };
+    unsigned count = qatomic_read(&tb_ctx.tb_flush_count);
+    int i;
+
+    if (!count) {
+        return;
+    }
+    g_string_append_printf(buf, "TB flush time       avg %zu us max %u us\n",
+                           qatomic_read(&tb_ctx.tb_flush_time_us) / count,
+                           qatomic_read(&tb_ctx.tb_flush_time_max_us));
+    g_string_append_printf(buf, "TB flush histogram ");
+    for (i = 0; i < TB_FLUSH_HIST_BUCKETS; i++) {
+        g_string_append_printf(buf, " %s:%u", labels[i],
+                               qatomic_read(&tb_ctx.tb_flush_time_hist[i]));
+    }
+    g_string_append_c(buf, '\n');
+}
+
 void dump_exec_info(GString *buf)
 {
     struct tb_tree_stats tst = {};
     struct qht_stats hst;
-    size_t nb_tbs, flush_full, flush_part, flush_elide;
+    size_t nb_tbs, flush_full, flush_part, flush_elide, flush_large;
+    size_t vtlb_hit, vtlb_miss;
 
     tcg_tb_foreach(tb_tree_stats_iter, &tst);
     nb_tbs = tst.nb_tbs;
@@ -748,11 +835,21 @@ void dump_exec_info(GString *buf)
                            qatomic_read(&tb_ctx.tb_flush_count));
     g_string_append_printf(buf, "TB invalidate count %u\n",
                            qatomic_read(&tb_ctx.tb_phys_invalidate_count));
+    dump_tb_flush_info(buf);
+    dump_tb_lookup_info(buf);
+    dump_cpu_exit_info(buf);
 
-    tlb_flush_counts(&flush_full, &flush_part, &flush_elide);
+    tlb_flush_counts(&flush_full, &flush_part, &flush_elide, &flush_large);
     g_string_append_printf(buf, "TLB full flushes    %zu\n", flush_full);
     g_string_append_printf(buf, "TLB partial flushes %zu\n", flush_part);
     g_string_append_printf(buf, "TLB elided flushes  %zu\n", flush_elide);
+    g_string_append_printf(buf, "TLB lpage flushes   %zu\n", flush_large);
+
+    tlb_victim_counts(&vtlb_hit, &vtlb_miss);
+    g_string_append_printf(buf, "victim TLB hits     %zu (%zu%% of misses)\n",
+                           vtlb_hit, vtlb_hit + vtlb_miss ?
+                           (vtlb_hit * 100) / (vtlb_hit + vtlb_miss) : 0);
+    g_string_append_printf(buf, "victim TLB misses   %zu\n", vtlb_miss);
     tcg_dump_info(buf);
 }
 
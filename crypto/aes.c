@@ -29,6 +29,12 @@
  */
 #include "qemu/osdep.h"
 #include "crypto/aes.h"
+#if defined(CONFIG_AES_NI_OPT)
+#include "qemu/cpuid.h"
+#include <wmmintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_AES)
+#include <arm_neon.h>
+#endif
 
 typedef uint32_t u32;
 typedef uint8_t u8;
@@ -1599,3 +1605,192 @@ void AES_decrypt(const unsigned char *in, unsigned char *out,
 }
 
 #endif /* AES_ASM */
+
+/*
+ * Single round primitives.  The portable versions are byte-at-a-time;
+ * the host versions run one AES instruction with an all-zero round key.
+ */
+
+static inline uint8_t aes_xtime(uint8_t x)
+{
+    return (x << 1) ^ (x & 0x80 ? 0x1b : 0);
+}
+
+static uint8_t aes_gfmul(uint8_t a, uint8_t b)
+{
+    uint8_t r = 0;
+
+    for (; b; b >>= 1, a = aes_xtime(a)) {
+        if (b & 1) {
+            r ^= a;
+        }
+    }
+    return r;
+}
+
+static void aes_mixcolumns(uint8_t s[16], bool inv)
+{
+    /* Coefficients of row 0; each following row rotates them right. */
+    static const uint8_t fwd_k[4] = { 0x02, 0x03, 0x01, 0x01 };
+    static const uint8_t inv_k[4] = { 0x0e, 0x0b, 0x0d, 0x09 };
+    const uint8_t *k = inv ? inv_k : fwd_k;
+    int c, r, j;
+
+    for (c = 0; c < 4; c++) {
+        uint8_t col[4];
+
+        memcpy(col, s + 4 * c, 4);
+        for (r = 0; r < 4; r++) {
+            uint8_t v = 0;
+
+            for (j = 0; j < 4; j++) {
+                v ^= aes_gfmul(col[j], k[(j - r) & 3]);
+            }
+            s[4 * c + r] = v;
+        }
+    }
+}
+
+static void aes_round_enc_generic(uint8_t out[16], const uint8_t in[16],
+                                  bool mix)
+{
+    uint8_t t[16];
+    int i;
+
+    for (i = 0; i < 16; i++) {
+        t[i] = AES_sbox[in[AES_shifts[i]]];
+    }
+    if (mix) {
+        aes_mixcolumns(t, false);
+    }
+    memcpy(out, t, 16);
+}
+
+static void aes_round_dec_generic(uint8_t out[16], const uint8_t in[16],
+                                  bool mix)
+{
+    uint8_t t[16];
+    int i;
+
+    for (i = 0; i < 16; i++) {
+        t[i] = AES_isbox[in[AES_ishifts[i]]];
+    }
+    if (mix) {
+        aes_mixcolumns(t, true);
+    }
+    memcpy(out, t, 16);
+}
+
+static void aes_round_imc_generic(uint8_t out[16], const uint8_t in[16])
+{
+    uint8_t t[16];
+
+    memcpy(t, in, 16);
+    aes_mixcolumns(t, true);
+    memcpy(out, t, 16);
+}
+
+#if defined(CONFIG_AES_NI_OPT)
+
+static void __attribute__((target("aes")))
+aes_round_enc_accel(uint8_t out[16], const uint8_t in[16], bool mix)
+{
+    __m128i s = _mm_loadu_si128((const __m128i *)in);
+    __m128i z = _mm_setzero_si128();
+
+    s = mix ? _mm_aesenc_si128(s, z) : _mm_aesenclast_si128(s, z);
+    _mm_storeu_si128((__m128i *)out, s);
+}
+
+static void __attribute__((target("aes")))
+aes_round_dec_accel(uint8_t out[16], const uint8_t in[16], bool mix)
+{
+    __m128i s = _mm_loadu_si128((const __m128i *)in);
+    __m128i z = _mm_setzero_si128();
+
+    s = mix ? _mm_aesdec_si128(s, z) : _mm_aesdeclast_si128(s, z);
+    _mm_storeu_si128((__m128i *)out, s);
+}
+
+static void __attribute__((target("aes")))
+aes_round_imc_accel(uint8_t out[16], const uint8_t in[16])
+{
+    __m128i s = _mm_loadu_si128((const __m128i *)in);
+
+    _mm_storeu_si128((__m128i *)out, _mm_aesimc_si128(s));
+}
+
+bool aes_round_accel;
+
+static void __attribute__((constructor)) aes_round_init(void)
+{
+    unsigned a, b, c, d;
+
+    if (__get_cpuid_max(0, NULL) >= 1) {
+        __cpuid(1, a, b, c, d);
+        aes_round_accel = (c & bit_AES) && (d & bit_SSE2);
+    }
+}
+
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_AES)
+
+/* AESE/AESD apply AddRoundKey first, which is a no-op with a zero key. */
+static void aes_round_enc_accel(uint8_t out[16], const uint8_t in[16],
+                                bool mix)
+{
+    uint8x16_t s = vaeseq_u8(vld1q_u8(in), vdupq_n_u8(0));
+
+    vst1q_u8(out, mix ? vaesmcq_u8(s) : s);
+}
+
+static void aes_round_dec_accel(uint8_t out[16], const uint8_t in[16],
+                                bool mix)
+{
+    uint8x16_t s = vaesdq_u8(vld1q_u8(in), vdupq_n_u8(0));
+
+    vst1q_u8(out, mix ? vaesimcq_u8(s) : s);
+}
+
+static void aes_round_imc_accel(uint8_t out[16], const uint8_t in[16])
+{
+    vst1q_u8(out, vaesimcq_u8(vld1q_u8(in)));
+}
+
+bool aes_round_accel = true;
+
+#else
+
+#define aes_round_enc_accel aes_round_enc_generic
+#define aes_round_dec_accel aes_round_dec_generic
+#define aes_round_imc_accel aes_round_imc_generic
+
+bool aes_round_accel;
+
+#endif
+
+void aes_round_enc(uint8_t out[16], const uint8_t in[16], bool mix)
+{
+    if (aes_round_accel) {
+        aes_round_enc_accel(out, in, mix);
+    } else {
+        aes_round_enc_generic(out, in, mix);
+    }
+}
+
+void aes_round_dec(uint8_t out[16], const uint8_t in[16], bool mix)
+{
+    if (aes_round_accel) {
+        aes_round_dec_accel(out, in, mix);
+    } else {
+        aes_round_dec_generic(out, in, mix);
+    }
+}
+
+void aes_round_imc(uint8_t out[16], const uint8_t in[16])
+{
+    if (aes_round_accel) {
+        aes_round_imc_accel(out, in);
+    } else {
+        aes_round_imc_generic(out, in);
+    }
+}
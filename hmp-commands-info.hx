@@ -269,6 +269,21 @@ SRST
     Show dynamic compiler info.
 ERST
 
+#if defined(CONFIG_TCG)
+    {
+        .name       = "tcg-profile",
+        .args_type  = "",
+        .params     = "",
+        .help       = "show guest PC samples taken by the TCG profiler",
+    },
+#endif
+
+SRST
+  ``info tcg-profile``
+    Show guest PC samples taken by the TCG profiler, in folded-stack format.
+    The profiler is controlled with ``tcg-profile start|stop``.
+ERST
+
 #if defined(CONFIG_TCG)
     {
         .name       = "opcount",
@@ -633,6 +633,24 @@ SRST
   whether profiling is on or off.
 ERST
 
+#if defined(CONFIG_TCG)
+    {
+        .name       = "tcg-profile",
+        .args_type  = "op:s,period:i?",
+        .params     = "start|stop [period]",
+        .help       = "start or stop sampling guest PCs with the TCG profiler. "
+                      "The optional period is the sampling interval in "
+                      "microseconds.",
+        .cmd        = hmp_tcg_profile,
+    },
+#endif
+
+SRST
+``tcg-profile start|stop`` [*period*]
+  Start or stop sampling guest PCs with the TCG profiler, optionally every
+  *period* microseconds. Use ``info tcg-profile`` to show the samples.
+ERST
+
     {
         .name       = "system_reset",
         .args_type  = "",
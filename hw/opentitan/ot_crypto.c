@@ -0,0 +1,152 @@
+/*
+ * QEMU OpenTitan AES block cipher engine
+ *
+ * Copyright (c) 2023 Rivos, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * Thin wrapper over the QEMU crypto layer, which relies on the host crypto
+ * library (and the host AES instructions it may use). The key schedule of
+ * the last key is kept, as the devices often run several operations with the
+ * same key.
+ *
+ * The gnutls backend has no ECB mode, and fakes it with a new CBC cipher for
+ * every block, which is much slower than the QEMU AES tables. Use the latter
+ * directly when gnutls is the crypto backend.
+ */
+
+#include "qemu/osdep.h"
+#include "qapi/error.h"
+#include "crypto/aes.h"
+#include "crypto/cipher.h"
+#include "hw/opentitan/ot_crypto.h"
+
+#if defined(CONFIG_GNUTLS_CRYPTO) && !defined(CONFIG_GCRYPT) && \
+    !defined(CONFIG_NETTLE)
+#define OT_CRYPTO_USE_QCRYPTO 0
+#else
+#define OT_CRYPTO_USE_QCRYPTO 1
+#endif
+
+#define OT_CRYPTO_AES_KEY_SIZE_MAX 32u
+
+struct OtCryptoAES {
+#if OT_CRYPTO_USE_QCRYPTO
+    QCryptoCipher *cipher;
+#else
+    AES_KEY enc_key;
+    AES_KEY dec_key;
+#endif
+    size_t key_len;
+    uint8_t key[OT_CRYPTO_AES_KEY_SIZE_MAX];
+};
+
+OtCryptoAES *ot_crypto_aes_allocate(void)
+{
+    return g_new0(OtCryptoAES, 1u);
+}
+
+void ot_crypto_aes_release(OtCryptoAES *aes)
+{
+    ot_crypto_aes_clear_key(aes);
+    g_free(aes);
+}
+
+void ot_crypto_aes_set_key(OtCryptoAES *aes, const void *key, size_t key_len)
+{
+    g_assert(key_len == 16u || key_len == 24u || key_len == 32u);
+
+    if (aes->key_len == key_len && !memcmp(aes->key, key, key_len)) {
+        return;
+    }
+
+#if OT_CRYPTO_USE_QCRYPTO
+    QCryptoCipherAlgorithm alg;
+
+    switch (key_len) {
+    case 16u:
+        alg = QCRYPTO_CIPHER_ALG_AES_128;
+        break;
+    case 24u:
+        alg = QCRYPTO_CIPHER_ALG_AES_192;
+        break;
+    default:
+        alg = QCRYPTO_CIPHER_ALG_AES_256;
+        break;
+    }
+
+    qcrypto_cipher_free(aes->cipher);
+    aes->cipher = qcrypto_cipher_new(alg, QCRYPTO_CIPHER_MODE_ECB, key,
+                                     key_len, &error_abort);
+#else
+    AES_set_encrypt_key(key, (int)key_len * 8, &aes->enc_key);
+    AES_set_decrypt_key(key, (int)key_len * 8, &aes->dec_key);
+#endif
+    memcpy(aes->key, key, key_len);
+    aes->key_len = key_len;
+}
+
+void ot_crypto_aes_clear_key(OtCryptoAES *aes)
+{
+#if OT_CRYPTO_USE_QCRYPTO
+    qcrypto_cipher_free(aes->cipher);
+    aes->cipher = NULL;
+#else
+    memset(&aes->enc_key, 0, sizeof(aes->enc_key));
+    memset(&aes->dec_key, 0, sizeof(aes->dec_key));
+#endif
+    aes->key_len = 0;
+    memset(aes->key, 0, sizeof(aes->key));
+}
+
+void ot_crypto_aes_encrypt(OtCryptoAES *aes, const void *in, void *out,
+                           size_t len)
+{
+    g_assert(aes->key_len);
+    g_assert(!(len % OT_CRYPTO_AES_BLOCK_SIZE));
+
+#if OT_CRYPTO_USE_QCRYPTO
+    qcrypto_cipher_encrypt(aes->cipher, in, out, len, &error_abort);
+#else
+    const uint8_t *src = in;
+    uint8_t *dst = out;
+
+    for (size_t pos = 0; pos < len; pos += OT_CRYPTO_AES_BLOCK_SIZE) {
+        AES_encrypt(&src[pos], &dst[pos], &aes->enc_key);
+    }
+#endif
+}
+
+void ot_crypto_aes_decrypt(OtCryptoAES *aes, const void *in, void *out,
+                           size_t len)
+{
+    g_assert(aes->key_len);
+    g_assert(!(len % OT_CRYPTO_AES_BLOCK_SIZE));
+
+#if OT_CRYPTO_USE_QCRYPTO
+    qcrypto_cipher_decrypt(aes->cipher, in, out, len, &error_abort);
+#else
+    const uint8_t *src = in;
+    uint8_t *dst = out;
+
+    for (size_t pos = 0; pos < len; pos += OT_CRYPTO_AES_BLOCK_SIZE) {
+        AES_decrypt(&src[pos], &dst[pos], &aes->dec_key);
+    }
+#endif
+}
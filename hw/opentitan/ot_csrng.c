@@ -37,6 +37,7 @@
 #include "qapi/error.h"
 #include "hw/opentitan/ot_alert.h"
 #include "hw/opentitan/ot_common.h"
+#include "hw/opentitan/ot_crypto.h"
 #include "hw/opentitan/ot_csrng.h"
 #include "hw/opentitan/ot_entropy_src.h"
 #include "hw/opentitan/ot_fifo32.h"
@@ -47,7 +48,6 @@
 #include "hw/riscv/ibex_common.h"
 #include "hw/riscv/ibex_irq.h"
 #include "hw/sysbus.h"
-#include "tomcrypt.h"
 #include "trace.h"
 
 
@@ -251,7 +251,6 @@ typedef enum {
 } OtCSRNGFsmState;
 
 typedef struct {
-    symmetric_ECB ecb; /* AES ECB context for tomcrypt */
     uint8_t v_counter[OT_CSRNG_AES_BLOCK_SIZE]; /* V a.k.a. the counter */
     uint8_t key[OT_CSRNG_AES_KEY_SIZE];
     uint32_t material[OT_CSRNG_SEED_WORD_COUNT];
@@ -279,6 +278,7 @@ typedef struct OtCSRNGInstance {
         } hw;
     };
     OtCSRNGDrng drng;
+    OtCryptoAES *aes; /* DRNG cipher, keyed with drng.key */
     bool defer_completion;
     QSIMPLEQ_ENTRY(OtCSRNGInstance) cmd_request;
     OtCSRNGState *parent;
@@ -304,7 +304,6 @@ struct OtCSRNGState {
     unsigned es_retry_count;
     unsigned state_db_ix;
     int entropy_gennum;
-    int aes_cipher; /* AES handle for tomcrypt */
     OtCSRNGFsmState state;
     OtCSRNGInstance *instances;
     OtCSRNGQueue cmd_requests;
@@ -550,15 +549,12 @@ static OtCSRNDCmdResult ot_csrng_drng_instanciate(
     uint8_t key[OT_CSRNG_AES_KEY_SIZE];
     memset(key, 0, sizeof(key));
 
-    int res;
-    res = ecb_start(inst->parent->aes_cipher, key, (int)sizeof(key), 0,
-                    &drng->ecb);
-    g_assert(res == CRYPT_OK);
+    ot_crypto_aes_set_key(inst->aes, key, sizeof(key));
 
     memcpy(drng->key, key, OT_CSRNG_AES_KEY_SIZE);
     drng->instantiated = true;
 
-    res = ot_csrng_drng_reseed(inst, entropy_src, flag0);
+    int res = ot_csrng_drng_reseed(inst, entropy_src, flag0);
     if (res) {
         drng->instantiated = false;
     }
@@ -571,7 +567,7 @@ static void ot_csrng_drng_uninstantiate(OtCSRNGInstance *inst)
     OtCSRNGDrng *drng = &inst->drng;
 
     if (drng->instantiated) {
-        ecb_done(&drng->ecb);
+        ot_crypto_aes_clear_key(inst->aes);
     }
 
     drng->instantiated = false;
@@ -593,18 +589,14 @@ static int ot_csrng_drng_update(OtCSRNGInstance *inst)
                                 OT_CSRNG_AES_BLOCK_SIZE);
 
     uint32_t tmp[OT_CSRNG_SEED_WORD_COUNT];
-    int res;
-    memset(tmp, 0, sizeof(tmp));
     uint8_t *ptmp = (uint8_t *)tmp;
+    /* build all the counter blocks, then encrypt them in a single pass */
     for (unsigned ix = 0; ix < OT_CSRNG_SEED_BYTE_COUNT;
          ix += OT_CSRNG_AES_BLOCK_SIZE) {
         ot_csrng_drng_increment(drng);
-
-        res = ecb_encrypt(drng->v_counter, ptmp, OT_CSRNG_AES_BLOCK_SIZE,
-                          &drng->ecb);
-        g_assert(res == CRYPT_OK);
-        ptmp += OT_CSRNG_AES_BLOCK_SIZE;
+        memcpy(&ptmp[ix], drng->v_counter, OT_CSRNG_AES_BLOCK_SIZE);
     }
+    ot_crypto_aes_encrypt(inst->aes, tmp, tmp, OT_CSRNG_SEED_BYTE_COUNT);
 
     for (unsigned ix = 0; ix < drng->material_len; ix++) {
         tmp[ix] ^= drng->material[ix];
@@ -612,13 +604,7 @@ static int ot_csrng_drng_update(OtCSRNGInstance *inst)
 
     ot_csrng_drng_clear_material(inst);
 
-    res = ecb_done(&drng->ecb);
-    g_assert(res == CRYPT_OK);
-
-    ptmp = (uint8_t *)tmp;
-    res = ecb_start(inst->parent->aes_cipher, ptmp, (int)OT_CSRNG_AES_KEY_SIZE,
-                    0, &drng->ecb);
-    g_assert(res == CRYPT_OK);
+    ot_crypto_aes_set_key(inst->aes, ptmp, OT_CSRNG_AES_KEY_SIZE);
 
     memcpy(drng->key, ptmp, OT_CSRNG_AES_KEY_SIZE);
     memcpy(drng->v_counter, &ptmp[OT_CSRNG_AES_KEY_SIZE],
@@ -689,11 +675,8 @@ static void ot_csrng_drng_generate(OtCSRNGInstance *inst, uint32_t *out,
     ot_csrng_drng_increment(drng);
     drng->rem_packet_count -= 1u;
 
-    int res;
-
-    res = ecb_encrypt(drng->v_counter, (uint8_t *)out, OT_CSRNG_AES_BLOCK_SIZE,
-                      &drng->ecb);
-    g_assert(res == CRYPT_OK);
+    ot_crypto_aes_encrypt(inst->aes, drng->v_counter, out,
+                          OT_CSRNG_AES_BLOCK_SIZE);
 
     xtrace_ot_csrng_show_buffer(ot_csrng_get_slot(inst), "out", out,
                                 OT_CSRNG_AES_BLOCK_SIZE);
@@ -1781,6 +1764,7 @@ static void ot_csrng_reset(DeviceState *dev)
         }
         OtCSRNGDrng *drng = &inst->drng;
         memset(drng, 0, sizeof(*drng));
+        ot_crypto_aes_clear_key(inst->aes);
     }
     ot_csrng_update_irqs(s);
     for (unsigned ix = 0; ix < PARAM_NUM_ALERTS; ix++) {
@@ -1800,12 +1784,6 @@ static void ot_csrng_init(Object *obj)
                           REGS_SIZE);
     sysbus_init_mmio(SYS_BUS_DEVICE(s), &s->mmio);
 
-    /* aes_desc is defined in libtomcrypt */
-    s->aes_cipher = register_cipher(&aes_desc);
-    if (s->aes_cipher < 0) {
-        error_report("OpenTitan AES: Unable to use libtomcrypt AES API");
-    }
-
     s->regs = g_new0(uint32_t, REGS_COUNT);
     for (unsigned ix = 0; ix < PARAM_NUM_IRQS; ix++) {
         ibex_sysbus_init_irq(obj, &s->irqs[ix]);
@@ -1824,6 +1802,7 @@ static void ot_csrng_init(Object *obj)
     for (unsigned ix = 0; ix < OT_CSRNG_HW_APP_MAX + 1u; ix++) {
         inst = &s->instances[ix];
         inst->parent = s;
+        inst->aes = ot_crypto_aes_allocate();
         ot_fifo32_create(&inst->cmd_fifo, OT_CSRNG_CMD_WORD_MAX);
         if (ix != SW_INSTANCE_ID) {
             inst->hw.filler_bh = qemu_bh_new(&ot_csrng_hwapp_filler_bh, inst);
@@ -317,6 +317,21 @@ static const char *REG_NAMES[REGS_COUNT] = {
 #define ES_FILL_RATE_NS \
     ((NANOSECONDS_PER_SECOND * ES_FILL_BITS) / (OT_AST_RANDOM_4BIT_RATE * 4u))
 #define OT_ENTROPY_SRC_FILL_WORD_COUNT (ES_FILL_BITS / (8u * sizeof(uint32_t)))
+/*
+ * Noise is produced in batches rather than on every ES_FILL_RATE_NS tick: a
+ * batch holds as many fill packets as the noise source rate allows since the
+ * previous one, and the scheduler is armed for about one output packet worth
+ * of noise. Bypass mode needs ES_BYPASS_FILL_COUNT fill packets to produce an
+ * output packet, the conditioner needs ES_COND_FILL_COUNT ones.
+ */
+#define ES_BYPASS_FILL_COUNT (OT_ENTROPY_SRC_PACKET_SIZE_BITS / ES_FILL_BITS)
+#define ES_COND_FILL_COUNT   (2048u / ES_FILL_BITS)
+#define ES_FILL_BATCH_MAX    ES_COND_FILL_COUNT
+/*
+ * Output packets kept ready on the HW route when no consumer is waiting for
+ * entropy; more are only produced on demand.
+ */
+#define ES_HW_PREFETCH_PACKETS 1u
 #define ES_WORD_COUNT                  (OT_ENTROPY_SRC_WORD_COUNT)
 #define ES_SWREAD_FIFO_WORD_COUNT      ES_WORD_COUNT
 #define ES_FINAL_FIFO_WORD_COUNT       (ES_WORD_COUNT * ES_FINAL_FIFO_DEPTH)
@@ -372,6 +387,8 @@ struct OtEntropySrcState {
     unsigned cond_word; /* count of words processed with SHA3 till hash */
     unsigned noise_count; /* count of consumed noise words since enabled */
     unsigned packet_count; /* count of output packets since enabled */
+    uint64_t fill_base_ns; /* time of the last noise batch */
+    bool hw_demand; /* a HW consumer is waiting for entropy */
     bool obs_fifo_en; /* observe FIFO accept incoming data */
     bool otp_fw_read;
     bool otp_fw_over;
@@ -494,6 +511,7 @@ int ot_entropy_src_get_random(OtEntropySrcState *s, int genid,
     case ENTROPY_SRC_STARTUP_PASS1:
     case ENTROPY_SRC_STARTUP_FAIL1:
         trace_ot_entropy_src_init_ongoing(STATE_NAME(s->state), s->state);
+        s->hw_demand = true;
         return 1; /* not ready */
     case ENTROPY_SRC_IDLE:
         qemu_log_mask(LOG_GUEST_ERROR, "%s: module is not enabled\n", __func__);
@@ -517,6 +535,9 @@ int ot_entropy_src_get_random(OtEntropySrcState *s, int genid,
 
     if (ot_fifo32_num_used(&s->final_fifo) < ES_WORD_COUNT) {
         trace_ot_entropy_src_no_entropy(ot_fifo32_num_used(&s->final_fifo));
+        /* resume noise production if it was idling */
+        s->hw_demand = true;
+        ot_entropy_src_update_filler(s);
         return 1;
     }
 
@@ -529,6 +550,7 @@ int ot_entropy_src_get_random(OtEntropySrcState *s, int genid,
 
     /* note: fips compliancy is only simulated here for now */
     *fips = fips_compliant && ot_entropy_src_is_fips_capable(s);
+    s->hw_demand = false;
 
     if (ot_fifo32_num_used(&s->final_fifo) < ES_WORD_COUNT) {
         ot_entropy_src_update_filler(s);
@@ -737,16 +759,39 @@ static bool ot_entropy_src_can_consume_entropy(OtEntropySrcState *s)
              !ot_entropy_src_is_fw_ov_mode(s));
 }
 
-static void ot_entropy_src_update_filler(OtEntropySrcState *s)
+static unsigned ot_entropy_src_packet_fill_count(OtEntropySrcState *s)
+{
+    return ot_entropy_src_is_bypass_mode(s) ? ES_BYPASS_FILL_COUNT :
+                                              ES_COND_FILL_COUNT;
+}
+
+static bool ot_entropy_src_accept_entropy(OtEntropySrcState *s, bool trace)
 {
     /* fill granule is OT_ENTROPY_SRC_FILL_WORD_COUNT bits */
     bool input =
         ot_fifo32_num_free(&s->input_fifo) >= OT_ENTROPY_SRC_FILL_WORD_COUNT;
-    bool output = ot_fifo32_num_free(&s->final_fifo) >= ES_WORD_COUNT;
+    bool output;
+    if (ot_entropy_src_is_hw_route(s) && !s->hw_demand) {
+        /* nobody is waiting for entropy, only prefetch the next packet(s) */
+        output = ot_fifo32_num_used(&s->final_fifo) <
+                 ES_WORD_COUNT * ES_HW_PREFETCH_PACKETS;
+    } else {
+        output = ot_fifo32_num_free(&s->final_fifo) >= ES_WORD_COUNT;
+    }
     bool process = ot_entropy_src_can_consume_entropy(s);
 
     bool accept_entropy = input && output && process;
-    trace_ot_entropy_src_update_filler(input, output, process, accept_entropy);
+    if (trace) {
+        trace_ot_entropy_src_update_filler(input, output, process,
+                                           accept_entropy);
+    }
+
+    return accept_entropy;
+}
+
+static void ot_entropy_src_update_filler(OtEntropySrcState *s)
+{
+    bool accept_entropy = ot_entropy_src_accept_entropy(s, true);
 
     if (!accept_entropy) {
         /* if cannot accept entropy, stop the entropy scheduler */
@@ -762,7 +807,10 @@ static void ot_entropy_src_update_filler(OtEntropySrcState *s)
         if (!timer_pending(s->scheduler)) {
             trace_ot_entropy_src_info("reschedule");
             uint64_t now = qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL);
-            timer_mod(s->scheduler, now + (uint64_t)ES_FILL_RATE_NS);
+            s->fill_base_ns = now;
+            timer_mod(s->scheduler,
+                      now + (uint64_t)ES_FILL_RATE_NS *
+                                ot_entropy_src_packet_fill_count(s));
         }
     }
 }
@@ -986,7 +1034,8 @@ static bool ot_entropy_src_fill_noise(OtEntropySrcState *s)
 
     /* push the whole entropy buffer into the input FIFO */
     unsigned pos = 0;
-    while (!ot_fifo32_is_full(&s->input_fifo) && pos < ES_WORD_COUNT) {
+    while (!ot_fifo32_is_full(&s->input_fifo) &&
+           pos < OT_ENTROPY_SRC_FILL_WORD_COUNT) {
         ot_fifo32_push(&s->input_fifo, buffer[pos++]);
     }
 
@@ -1008,10 +1057,21 @@ static void ot_entropy_src_noise_refill(void *opaque)
 {
     OtEntropySrcState *s = opaque;
 
+    /* produce as much noise as the source rate allows since last batch */
+    uint64_t now = qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL);
+    uint64_t count = (now - s->fill_base_ns) / ES_FILL_RATE_NS;
+    count = MAX(MIN(count, (uint64_t)ES_FILL_BATCH_MAX), 1u);
+    s->fill_base_ns = now;
+
     if (!ot_entropy_src_fill_noise(s)) {
         trace_ot_entropy_src_info("FIFO already filled up");
         return;
     }
+    while (--count && ot_entropy_src_accept_entropy(s, false)) {
+        if (!ot_entropy_src_fill_noise(s)) {
+            break;
+        }
+    }
 
     switch (s->state) {
     case ENTROPY_SRC_BOOT_HT_RUNNING:
@@ -1317,6 +1377,7 @@ static void ot_entropy_src_regs_write(void *opaque, hwaddr addr, uint64_t val64,
                     ot_entropy_src_change_state(s, ENTROPY_SRC_BOOT_HT_RUNNING);
                 }
                 uint64_t now = qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL);
+                s->fill_base_ns = now;
                 timer_mod(s->scheduler,
                           now + (uint64_t)OT_ENTROPY_SRC_BOOT_DELAY_NS);
             }
@@ -1569,6 +1630,7 @@ static void ot_entropy_src_reset(DeviceState *dev)
     s->cond_word = 0u;
     s->noise_count = 0u;
     s->packet_count = 0u;
+    s->hw_demand = false;
 
     ot_entropy_src_update_irqs(s);
     for (unsigned ix = 0; ix < PARAM_NUM_ALERTS; ix++) {
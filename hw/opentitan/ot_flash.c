@@ -29,6 +29,8 @@
  */
 
 #include "qemu/osdep.h"
+#include "qemu/bitmap.h"
+#include "qemu/error-report.h"
 #include "qemu/guest-random.h"
 #include "qemu/log.h"
 #include "qemu/main-loop.h"
@@ -140,6 +142,12 @@ REG32(MP_REGION_5, 0x84u)
 REG32(MP_REGION_6, 0x88u)
 REG32(MP_REGION_7, 0x8cu)
 REG32(DEFAULT_REGION, 0x90u)
+    FIELD(DEFAULT_REGION, RD_EN, 0u, 4u)
+    FIELD(DEFAULT_REGION, PROG_EN, 4u, 4u)
+    FIELD(DEFAULT_REGION, ERASE_EN, 8u, 4u)
+    FIELD(DEFAULT_REGION, SCRAMBLE_EN, 12u, 4u)
+    FIELD(DEFAULT_REGION, ECC_EN, 16u, 4u)
+    FIELD(DEFAULT_REGION, HE_EN, 20u, 4u)
 REG32(BANK0_INFO0_REGWEN_0, 0x94u)
     SHARED_FIELD(BANK_REGWEN, 0u, 1u)
 REG32(BANK0_INFO0_REGWEN_1, 0x98u)
@@ -304,6 +312,13 @@ REG32(RD_FIFO, 0x1b4u)
      MP_REGION_CFG_SCRAMBLE_EN_MASK | \
      MP_REGION_CFG_ECC_EN_MASK | \
      MP_REGION_CFG_HE_EN_MASK)
+#define DEFAULT_REGION_MASK \
+    (R_DEFAULT_REGION_RD_EN_MASK | \
+     R_DEFAULT_REGION_PROG_EN_MASK | \
+     R_DEFAULT_REGION_ERASE_EN_MASK | \
+     R_DEFAULT_REGION_SCRAMBLE_EN_MASK | \
+     R_DEFAULT_REGION_ECC_EN_MASK | \
+     R_DEFAULT_REGION_HE_EN_MASK)
 #define MP_REGION_MASK \
      (MP_REGION_BASE_MASK | \
       MP_REGION_SIZE_MASK)
@@ -595,6 +610,8 @@ typedef enum {
     OP_NONE,
     OP_INIT,
     OP_READ,
+    OP_PROG,
+    OP_ERASE,
 } OtFlashOperation;
 
 enum {
@@ -612,9 +629,13 @@ typedef struct {
     unsigned size; /* size in bytes of the partition */
 } OtFlashInfoPart;
 
+/*
+ * Storage offsets are byte offsets in the backend storage, excluding the
+ * header: the data partitions of all banks come first, then the info
+ * partitions of all banks.
+ */
 typedef struct {
-    uint32_t *storage; /* overall buffer for the storage backend */
-    uint32_t *data; /* data buffer (all partitions/banks) */
+    uint32_t *data; /* data buffer (all banks), RAM of the data region */
     uint32_t *info; /* info buffer (all partitions/banks) */
     unsigned bank_count; /* count of banks */
     unsigned size; /* overall storage size in bytes (excl. header) */
@@ -622,6 +643,8 @@ typedef struct {
     unsigned info_size; /* info buffer size of a bank in bytes */
     unsigned info_part_count; /* count of info partition (per bank) */
     OtFlashInfoPart info_parts[MAX_INFO_PART_COUNT];
+    unsigned offset; /* offset of the storage in the backend */
+    unsigned long *dirty; /* pages to write back, NULL if read-only backend */
 } OtFlashStorage;
 
 typedef struct {
@@ -663,6 +686,7 @@ struct OtFlashState {
         unsigned address;
         unsigned info_sel;
         bool info_part;
+        bool bank_erase;
     } op;
     OtFifo32 rd_fifo;
     OtFlashStorage flash;
@@ -751,28 +775,23 @@ static void ot_flash_op_complete(OtFlashState *s, uint32_t ebit, uint32_t eaddr)
     ot_flash_update_irqs(s);
 }
 
-static void ot_flash_op_read(OtFlashState *s)
+/*
+ * Convert the address of the current operation into a storage offset,
+ * checking that @len bytes fit in the selected partition. On error, the
+ * operation is completed and false is returned.
+ */
+static bool ot_flash_op_offset(OtFlashState *s, unsigned len, unsigned *offset)
 {
-    if (ot_fifo32_is_full(&s->rd_fifo)) {
-        xtrace_ot_flash_error("read while RD FIFO full");
-        return;
-    }
-    unsigned max_size;
-    unsigned offset;
-    unsigned address;
     OtFlashStorage *storage = &s->flash;
-    uint32_t *src;
+    unsigned address;
 
     if (s->op.info_part) {
         if (s->op.info_sel >= storage->info_part_count) {
             qemu_log_mask(LOG_GUEST_ERROR, "%s: invalid info partition: %u\n",
                           __func__, s->op.info_sel);
             ot_flash_op_complete(s, R_ERR_CODE_MP_ERR_MASK, s->op.address);
-            return;
+            return false;
         }
-        max_size = storage->info_size;
-        /* relative storage offset in the info storage */
-        offset = storage->info_parts[s->op.info_sel].offset;
         unsigned bank_size = storage->data_size;
         /* extract the bank from the address */
         unsigned bank = s->op.address / bank_size;
@@ -780,42 +799,189 @@ static void ot_flash_op_read(OtFlashState *s)
             qemu_log_mask(LOG_GUEST_ERROR, "%s: invalid bank: %d\n", __func__,
                           bank);
             ot_flash_op_complete(s, R_ERR_CODE_MP_ERR_MASK, s->op.address);
-            return;
+            return false;
         }
         /* get the adress relative to the bank */
         address = s->op.address % bank_size;
-        if (address + s->op.count * sizeof(uint32_t) >=
-            storage->info_parts[s->op.info_sel].size) {
+        if (address + len > storage->info_parts[s->op.info_sel].size) {
             qemu_log_mask(LOG_GUEST_ERROR,
                           "%s: invalid address in partition: %u %u\n", __func__,
                           address, s->op.info_sel);
             ot_flash_op_complete(s, R_ERR_CODE_MP_ERR_MASK, s->op.address);
-            return;
+            return false;
         }
         /* add the bank offset of the first byte of info part */
         address += bank * storage->info_size;
         /* add the offset of the partition in the current bank */
-        address += offset;
-        src = storage->info;
+        address += storage->info_parts[s->op.info_sel].offset;
         trace_ot_flash_info_part(s->op.address, bank, s->op.info_sel, address);
+        /* info partitions follow the data partitions */
+        address += storage->bank_count * storage->data_size;
     } else {
-        max_size = storage->data_size;
         address = s->op.address;
-        src = storage->data;
+        if (address + len > storage->bank_count * storage->data_size) {
+            qemu_log_mask(LOG_GUEST_ERROR, "%s: invalid data address: 0x%x\n",
+                          __func__, address);
+            ot_flash_op_complete(s, R_ERR_CODE_MP_ERR_MASK, s->op.address);
+            return false;
+        }
+    }
+
+    *offset = address;
+    return true;
+}
+
+/*
+ * Check the memory protection configuration of the page at the address of
+ * the current operation, for a program or an @erase operation. Data pages
+ * use the first enabled region that contains them, or the default region;
+ * info pages use their own page configuration.
+ */
+static bool ot_flash_op_is_allowed(OtFlashState *s, bool erase)
+{
+    static const unsigned info_cfg_regs[REG_NUM_BANKS][NUM_INFO_TYPES] = {
+        { R_BANK0_INFO0_PAGE_CFG_0, R_BANK0_INFO1_PAGE_CFG,
+          R_BANK0_INFO2_PAGE_CFG_0 },
+        { R_BANK1_INFO0_PAGE_CFG_0, R_BANK1_INFO1_PAGE_CFG,
+          R_BANK1_INFO2_PAGE_CFG_0 },
+    };
+    static const unsigned info_pages[NUM_INFO_TYPES] = {
+        NUM_INFOS0, NUM_INFOS1, NUM_INFOS2
+    };
+    uint32_t cfg;
+    unsigned en;
+
+    if (s->op.info_part) {
+        unsigned bank = s->op.address / s->flash.data_size;
+        unsigned page = (s->op.address % s->flash.data_size) / BYTES_PER_PAGE;
+        if (bank >= REG_NUM_BANKS || s->op.info_sel >= NUM_INFO_TYPES ||
+            page >= info_pages[s->op.info_sel]) {
+            en = OT_MULTIBITBOOL4_FALSE;
+        } else {
+            cfg = s->regs[info_cfg_regs[bank][s->op.info_sel] + page];
+            if (SHARED_FIELD_EX32(cfg, BANK_INFO_PAGE_CFG_EN) !=
+                OT_MULTIBITBOOL4_TRUE) {
+                en = OT_MULTIBITBOOL4_FALSE;
+            } else if (erase) {
+                en = SHARED_FIELD_EX32(cfg, BANK_INFO_PAGE_CFG_ERASE_EN);
+            } else {
+                en = SHARED_FIELD_EX32(cfg, BANK_INFO_PAGE_CFG_PROG_EN);
+            }
+        }
+    } else {
+        unsigned page = s->op.address / BYTES_PER_PAGE;
+        unsigned ix;
+        for (ix = 0; ix < NUM_REGIONS; ix++) {
+            uint32_t region = s->regs[R_MP_REGION_0 + ix];
+            unsigned base = SHARED_FIELD_EX32(region, MP_REGION_BASE);
+            unsigned size = SHARED_FIELD_EX32(region, MP_REGION_SIZE);
+            cfg = s->regs[R_MP_REGION_CFG_0 + ix];
+            if (SHARED_FIELD_EX32(cfg, MP_REGION_CFG_EN) ==
+                    OT_MULTIBITBOOL4_TRUE &&
+                page >= base && page < base + size) {
+                break;
+            }
+        }
+        if (ix < NUM_REGIONS) {
+            en = erase ? SHARED_FIELD_EX32(cfg, MP_REGION_CFG_ERASE_EN) :
+                         SHARED_FIELD_EX32(cfg, MP_REGION_CFG_PROG_EN);
+        } else {
+            cfg = s->regs[R_DEFAULT_REGION];
+            en = erase ? FIELD_EX32(cfg, DEFAULT_REGION, ERASE_EN) :
+                         FIELD_EX32(cfg, DEFAULT_REGION, PROG_EN);
+        }
     }
 
-    /* sanity check */
-    if (address >= max_size * storage->bank_count) {
-        xtrace_ot_flash_error("read address out of bound");
-        g_assert_not_reached();
+    if (en != OT_MULTIBITBOOL4_TRUE) {
+        qemu_log_mask(LOG_GUEST_ERROR, "%s: %s not allowed at 0x%x\n",
+                      __func__, erase ? "erase" : "program", s->op.address);
+        return false;
     }
 
-    /* convert to word address */
-    address /= sizeof(uint32_t);
+    return true;
+}
+
+static uint32_t *ot_flash_storage_ptr(OtFlashStorage *storage, unsigned offset)
+{
+    unsigned data_total = storage->bank_count * storage->data_size;
+
+    if (offset < data_total) {
+        return &storage->data[offset / sizeof(uint32_t)];
+    }
+
+    return &storage->info[(offset - data_total) / sizeof(uint32_t)];
+}
+
+/* Flag a storage range modified by a program or erase operation */
+static void ot_flash_storage_update(OtFlashState *s, unsigned offset,
+                                    unsigned len)
+{
+    OtFlashStorage *storage = &s->flash;
+
+#if !DATA_PART_USE_IO_OPS
+    if (offset < storage->bank_count * storage->data_size) {
+        /* code may execute in place from the data partitions */
+        memory_region_flush_rom_device(&s->mmio.mem, offset, len);
+    }
+#endif
+
+    if (storage->dirty) {
+        unsigned first = offset / BYTES_PER_PAGE;
+        unsigned last = (offset + len - 1u) / BYTES_PER_PAGE;
+        bitmap_set(storage->dirty, first, last - first + 1u);
+    }
+}
+
+/* Write the modified pages back to the backend */
+static void ot_flash_storage_write_back(OtFlashState *s)
+{
+    OtFlashStorage *storage = &s->flash;
+
+    if (!storage->dirty) {
+        return;
+    }
+
+    unsigned page_count = storage->size / BYTES_PER_PAGE;
+    unsigned data_pages =
+        storage->bank_count * storage->data_size / BYTES_PER_PAGE;
+    unsigned first = find_first_bit(storage->dirty, page_count);
+
+    while (first < page_count) {
+        unsigned end = find_next_zero_bit(storage->dirty, page_count, first);
+        /* data and info partitions are not contiguous in memory */
+        if (first < data_pages && end > data_pages) {
+            end = data_pages;
+        }
+        unsigned offset = first * BYTES_PER_PAGE;
+        unsigned len = (end - first) * BYTES_PER_PAGE;
+        int rc = blk_pwrite(s->blk, (int64_t)(storage->offset + offset), len,
+                            ot_flash_storage_ptr(storage, offset), 0);
+        if (rc < 0) {
+            error_report("%s: cannot write back flash pages %u..%u: %s",
+                         __func__, first, end - 1u, strerror(-rc));
+        }
+        bitmap_clear(storage->dirty, first, end - first);
+        first = find_next_bit(storage->dirty, page_count, end);
+    }
+}
+
+static void ot_flash_op_read(OtFlashState *s)
+{
+    if (ot_fifo32_is_full(&s->rd_fifo)) {
+        xtrace_ot_flash_error("read while RD FIFO full");
+        return;
+    }
+
+    unsigned offset;
+    if (!ot_flash_op_offset(s, s->op.count * sizeof(uint32_t), &offset)) {
+        return;
+    }
+    const uint32_t *src = ot_flash_storage_ptr(&s->flash, offset);
 
     while (s->op.count) {
-        uint32_t word = src[address++];
+        uint32_t word = *src++;
         s->op.count--;
+        s->op.address += sizeof(uint32_t);
         if (!ot_flash_fifo_in_reset(s)) {
             ot_fifo32_push(&s->rd_fifo, word);
             s->regs[R_STATUS] &= ~R_STATUS_RD_EMPTY_MASK;
@@ -833,6 +999,76 @@ static void ot_flash_op_read(OtFlashState *s)
     }
 }
 
+static void ot_flash_op_program(OtFlashState *s, uint32_t word)
+{
+    if (s->op.kind != OP_PROG) {
+        qemu_log_mask(LOG_GUEST_ERROR, "%s: no program operation\n",
+                      __func__);
+        return;
+    }
+
+    unsigned offset;
+    if (!ot_flash_op_offset(s, sizeof(uint32_t), &offset)) {
+        return;
+    }
+
+    /* programming can only clear bits, erasing sets them back */
+    *ot_flash_storage_ptr(&s->flash, offset) &= word;
+    ot_flash_storage_update(s, offset, sizeof(uint32_t));
+
+    s->op.address += sizeof(uint32_t);
+    if (!--s->op.count) {
+        ot_flash_storage_write_back(s);
+        ot_flash_op_complete(s, 0u, 0u);
+    }
+}
+
+static void ot_flash_storage_erase(OtFlashState *s, unsigned offset,
+                                   unsigned len)
+{
+    memset(ot_flash_storage_ptr(&s->flash, offset), 0xff, len);
+    ot_flash_storage_update(s, offset, len);
+}
+
+static void ot_flash_op_erase(OtFlashState *s)
+{
+    OtFlashStorage *storage = &s->flash;
+    unsigned offset;
+
+    if (s->op.bank_erase) {
+        unsigned bank = s->op.address / storage->data_size;
+        if (bank >= storage->bank_count ||
+            !(s->regs[R_MP_BANK_CFG_SHADOWED] &
+              (R_MP_BANK_CFG_SHADOWED_ERASE_EN_0_MASK << bank))) {
+            qemu_log_mask(LOG_GUEST_ERROR, "%s: bank %u erase not allowed\n",
+                          __func__, bank);
+            ot_flash_op_complete(s, R_ERR_CODE_MP_ERR_MASK, s->op.address);
+            return;
+        }
+        ot_flash_storage_erase(s, bank * storage->data_size,
+                               storage->data_size);
+        if (s->op.info_part) {
+            /* info partitions are only erased if selected */
+            offset = storage->bank_count * storage->data_size +
+                     bank * storage->info_size;
+            ot_flash_storage_erase(s, offset, storage->info_size);
+        }
+    } else {
+        s->op.address &= ~(BYTES_PER_PAGE - 1u);
+        if (!ot_flash_op_offset(s, BYTES_PER_PAGE, &offset)) {
+            return;
+        }
+        if (!ot_flash_op_is_allowed(s, true)) {
+            ot_flash_op_complete(s, R_ERR_CODE_MP_ERR_MASK, s->op.address);
+            return;
+        }
+        ot_flash_storage_erase(s, offset, BYTES_PER_PAGE);
+    }
+
+    ot_flash_storage_write_back(s);
+    ot_flash_op_complete(s, 0u, 0u);
+}
+
 static void ot_flash_op_execute(OtFlashState *s)
 {
     switch (s->op.kind) {
@@ -840,6 +1076,13 @@ static void ot_flash_op_execute(OtFlashState *s)
         trace_ot_flash_op_start(s->op.kind);
         ot_flash_op_read(s);
         break;
+    case OP_PROG:
+        /* words are programmed as they are pushed into the PROG FIFO */
+        break;
+    case OP_ERASE:
+        trace_ot_flash_op_start(s->op.kind);
+        ot_flash_op_erase(s);
+        break;
     default:
         xtrace_ot_flash_error("unsupported");
         break;
@@ -1096,6 +1339,48 @@ static void ot_flash_regs_write(void *opaque, hwaddr addr, uint64_t val64,
                 s->op.info_sel = info_sel;
                 xtrace_ot_flash_info("Read from", s->op.address);
                 break;
+            case 1:
+                if (!(s->regs[R_PROG_TYPE_EN] &
+                      (prog_sel ? R_PROG_TYPE_EN_REPAIR_MASK :
+                                  R_PROG_TYPE_EN_NORMAL_MASK))) {
+                    qemu_log_mask(LOG_GUEST_ERROR,
+                                  "%s: program type %u not enabled\n",
+                                  __func__, prog_sel);
+                    ot_flash_op_complete(s, R_ERR_CODE_PROG_TYPE_ERR_MASK,
+                                         s->regs[R_ADDR]);
+                    return;
+                }
+                s->op.kind = OP_PROG;
+                s->op.address = s->regs[R_ADDR] & ~3u;
+                s->op.info_part = part_sel;
+                s->op.info_sel = info_sel;
+                trace_ot_flash_op_start(s->op.kind);
+                /* a program operation cannot cross a program window */
+                if ((s->op.address % REG_BUS_PGM_RES_BYTES) +
+                        (num + 1u) * sizeof(uint32_t) >
+                    REG_BUS_PGM_RES_BYTES) {
+                    qemu_log_mask(LOG_GUEST_ERROR,
+                                  "%s: program window overflow: 0x%x %u\n",
+                                  __func__, s->op.address, num + 1u);
+                    ot_flash_op_complete(s, R_ERR_CODE_PROG_WIN_ERR_MASK,
+                                         s->op.address);
+                    return;
+                }
+                if (!ot_flash_op_is_allowed(s, false)) {
+                    ot_flash_op_complete(s, R_ERR_CODE_MP_ERR_MASK,
+                                         s->op.address);
+                    return;
+                }
+                xtrace_ot_flash_info("Program at", s->op.address);
+                break;
+            case 2:
+                s->op.kind = OP_ERASE;
+                s->op.address = s->regs[R_ADDR];
+                s->op.info_part = part_sel;
+                s->op.info_sel = info_sel;
+                s->op.bank_erase = erase_sel;
+                xtrace_ot_flash_info("Erase at", s->op.address);
+                break;
             default:
                 qemu_log_mask(LOG_UNIMP, "%s: Operation %u not implemented\n",
                               __func__, op);
@@ -1111,7 +1396,13 @@ static void ot_flash_regs_write(void *opaque, hwaddr addr, uint64_t val64,
         s->regs[reg] = val32;
         break;
     case R_PROG_TYPE_EN:
+        if (ot_flash_regs_is_wr_enabled(s, R_CTRL_REGWEN)) {
+            val32 &= R_PROG_TYPE_EN_NORMAL_MASK | R_PROG_TYPE_EN_REPAIR_MASK;
+            s->regs[reg] &= val32; /* rw0c */
+        }
+        break;
     case R_ERASE_SUSPEND:
+        /* erase operations complete immediately, nothing to suspend */
         break;
     case R_REGION_CFG_REGWEN_0:
     case R_REGION_CFG_REGWEN_1:
@@ -1186,7 +1477,7 @@ static void ot_flash_regs_write(void *opaque, hwaddr addr, uint64_t val64,
         }
         break;
     case R_DEFAULT_REGION:
-        val32 &= MP_REGION_CFG_MASK;
+        val32 &= DEFAULT_REGION_MASK;
         s->regs[reg] = val32;
         break;
     case R_BANK0_INFO0_PAGE_CFG_0:
@@ -1265,7 +1556,9 @@ static void ot_flash_regs_write(void *opaque, hwaddr addr, uint64_t val64,
         if (val32) {
             ot_fifo32_reset(&s->rd_fifo);
         }
+        break;
     case R_PROG_FIFO:
+        ot_flash_op_program(s, val32);
         break;
     case R_STATUS:
     case R_DEBUG_STATE:
@@ -1576,15 +1869,13 @@ static const char *ot_flash_hexdump(const uint8_t *buf, size_t size)
 static void ot_flash_load(OtFlashState *s, Error **errp)
 {
     /*
-     * Notes:
-     *   1. only support read access to the flash backend
-     *   2. only data partition for now
+     * Note: the data partitions are loaded from ot_flash_load_data(), once
+     * the memory region that holds them has been created.
      */
 
     OtFlashStorage *flash = &s->flash;
     memset(flash, 0, sizeof(OtFlashStorage));
 
-    uintptr_t base;
     unsigned flash_size;
     unsigned data_size;
     unsigned info_size;
@@ -1592,8 +1883,8 @@ static void ot_flash_load(OtFlashState *s, Error **errp)
     memset(flash->info_parts, 0, sizeof(flash->info_parts));
 
     if (s->blk) {
-        uint64_t perm = BLK_PERM_CONSISTENT_READ |
-                        (blk_supports_write_perm(s->blk) ? BLK_PERM_WRITE : 0);
+        bool write = blk_supports_write_perm(s->blk);
+        uint64_t perm = BLK_PERM_CONSISTENT_READ | (write ? BLK_PERM_WRITE : 0);
         (void)blk_set_perm(s->blk, perm, perm, errp);
 
         static_assert(sizeof(OtFlashBackendHeader) == 32u,
@@ -1649,14 +1940,15 @@ static void ot_flash_load(OtFlashState *s, Error **errp)
 
         g_assert(pg_offset == info_size);
 
-        flash->storage = blk_blockalign(s->blk, flash_size);
-        base = (uintptr_t)flash->storage;
-        g_assert(!(base & (sizeof(uint64_t) - 1u)));
+        unsigned info_total = header->bank * info_size;
+        flash->info = blk_blockalign(s->blk, info_total);
+        g_assert(!((uintptr_t)flash->info & (sizeof(uint64_t) - 1u)));
 
         unsigned offset = offsetof(OtFlashBackendHeader, hlength) +
                           sizeof(header->hlength) + header->hlength;
 
-        rc = blk_pread(s->blk, (int64_t)offset, flash_size, flash->storage, 0);
+        rc = blk_pread(s->blk, (int64_t)(offset + header->bank * data_size),
+                       info_total, flash->info, 0);
         if (rc < 0) {
             error_setg(errp, "failed to read the initial flash content: %d",
                        rc);
@@ -1664,7 +1956,11 @@ static void ot_flash_load(OtFlashState *s, Error **errp)
         }
 
         flash->bank_count = header->bank;
-        flash->size = flash_size;
+        flash->offset = offset;
+        if (write) {
+            /* program and erase operations are written back page-wise */
+            flash->dirty = bitmap_new(flash_size / header->psize);
+        }
 
         /* two banks, OTRE+OTB0 binaries/bank */
         size_t debug_trailer_size =
@@ -1693,11 +1989,9 @@ static void ot_flash_load(OtFlashState *s, Error **errp)
         info_size = BYTES_PER_PAGE * (NUM_INFOS0 + NUM_INFOS1 + NUM_INFOS2);
         flash_size = REG_NUM_BANKS * (data_size + info_size);
 
-        flash->storage =
-            g_new0(uint32_t, DIV_ROUND_UP(flash_size, sizeof(uint32_t)));
-        base = (uintptr_t)flash->storage;
-
-        memset(flash->storage, 0xff, flash_size);
+        unsigned info_total = REG_NUM_BANKS * info_size;
+        flash->info = g_new(uint32_t, info_total / sizeof(uint32_t));
+        memset(flash->info, 0xff, info_total);
 
         flash->info_parts[0u].size = NUM_INFOS0 * BYTES_PER_PAGE;
         flash->info_parts[0u].offset = 0;
@@ -1727,12 +2021,28 @@ static void ot_flash_load(OtFlashState *s, Error **errp)
      *   - INFO2 bank 1
      * - Debug info (ELF file names)
      */
-    flash->data = (uint32_t *)(base);
-    flash->info = (uint32_t *)(base + flash->bank_count * data_size);
+    flash->size = flash_size;
     flash->data_size = data_size;
     flash->info_size = info_size;
 }
 
+static void ot_flash_load_data(OtFlashState *s, Error **errp)
+{
+    OtFlashStorage *flash = &s->flash;
+    unsigned data_total = flash->bank_count * flash->data_size;
+
+    if (!s->blk) {
+        memset(flash->data, 0xff, data_total);
+        return;
+    }
+
+    int rc = blk_pread(s->blk, (int64_t)flash->offset, data_total,
+                       flash->data, 0);
+    if (rc < 0) {
+        error_setg(errp, "failed to read the initial flash content: %d", rc);
+    }
+}
+
 #if DATA_PART_USE_IO_OPS
 static uint64_t ot_flash_mem_read(void *opaque, hwaddr addr, unsigned size)
 {
@@ -1780,6 +2090,34 @@ static const MemoryRegionOps ot_flash_mem_ops = {
 #if LOG_GPR_ON_FLASH_DATA_ACCESS
 #warning "Cannot use LOG_GPR_ON_FLASH_DATA_ACCESS w/o DATA_PART_USE_IO_OPS"
 #endif
+
+/*
+ * The data partitions are a ROM device that always stays in ROMD mode:
+ * guest reads are served straight from RAM and only writes reach these
+ * handlers.
+ */
+static uint64_t ot_flash_mem_read(void *opaque, hwaddr addr, unsigned size)
+{
+    OtFlashState *s = opaque;
+
+    return ldn_le_p((uint8_t *)s->flash.data + addr, (int)size);
+}
+
+static void ot_flash_mem_write(void *opaque, hwaddr addr, uint64_t val64,
+                               unsigned size)
+{
+    qemu_log_mask(LOG_GUEST_ERROR,
+                  "%s: data partition is not writable, 0x%" HWADDR_PRIx "\n",
+                  __func__, addr);
+}
+
+static const MemoryRegionOps ot_flash_mem_ops = {
+    .read = &ot_flash_mem_read,
+    .write = &ot_flash_mem_write,
+    .endianness = DEVICE_LITTLE_ENDIAN,
+    .impl.min_access_size = 1u,
+    .impl.max_access_size = 4u,
+};
 #endif /* DATA_PART_USE_IO_OPS */
 
 static void ot_flash_realize(DeviceState *dev, Error **errp)
@@ -1794,13 +2132,19 @@ static void ot_flash_realize(DeviceState *dev, Error **errp)
 #if DATA_PART_USE_IO_OPS
     memory_region_init_io(mr, OBJECT(dev), &ot_flash_mem_ops, s,
                           TYPE_OT_FLASH "-mem", size);
+    s->flash.data = g_new(uint32_t, size / sizeof(uint32_t));
 #else
-    /* there is no "memory_region_init_rom_ptr" - use ram_ptr variant and r/o */
-    memory_region_init_ram_ptr(mr, OBJECT(dev), TYPE_OT_FLASH "-mem", size,
-                               (void *)s->flash.data);
-    mr->readonly = true;
+    /*
+     * ROM device: program and erase operations update the RAM directly,
+     * then flush the modified range to invalidate any translated code.
+     */
+    memory_region_init_rom_device(mr, OBJECT(dev), &ot_flash_mem_ops, s,
+                                  TYPE_OT_FLASH "-mem", size, &error_fatal);
+    s->flash.data = memory_region_get_ram_ptr(mr);
 #endif /* DATA_PART_USE_IO_OPS */
 
+    ot_flash_load_data(s, &error_fatal);
+
     sysbus_init_mmio(SYS_BUS_DEVICE(s), mr);
 }
 
@@ -254,9 +254,12 @@ static void ot_hmac_fifo_trigger_update(void *opaque)
     trace_ot_hmac_debug("ot_hmac_fifo_trigger_update");
 
     if (!fifo8_is_empty(&s->input_fifo)) {
+        /* the FIFO may wrap, hash it in at most two contiguous spans */
         while (!fifo8_is_empty(&s->input_fifo)) {
-            uint8_t value = fifo8_pop(&s->input_fifo);
-            sha256_process(&s->ctx->state, &value, 1);
+            uint32_t num;
+            uint32_t max = fifo8_num_used(&s->input_fifo);
+            const uint8_t *buf = fifo8_pop_buf(&s->input_fifo, max, &num);
+            sha256_process(&s->ctx->state, buf, num);
         }
 
         /* assert FIFO Empty IRQ */
@@ -546,14 +549,17 @@ static void ot_hmac_fifo_write(void *opaque, hwaddr addr, uint64_t value,
 
     ibex_irq_set(&s->clkmgr, true);
 
-    for (unsigned i = 0; i < size; i++) {
-        uint8_t b = value;
+    uint8_t buf[sizeof(uint32_t)];
+    stl_le_p(buf, (uint32_t)value);
+
+    for (unsigned pos = 0; pos < size;) {
         if (fifo8_is_full(&s->input_fifo)) {
             /* FIFO full. Should stall but cannot be done in QEMU? */
             ot_hmac_fifo_trigger_update(s);
         }
-        fifo8_push(&s->input_fifo, b);
-        value >>= 8u;
+        unsigned len = MIN(size - pos, fifo8_num_free(&s->input_fifo));
+        fifo8_push_all(&s->input_fifo, &buf[pos], len);
+        pos += len;
     }
 
     s->regs->msg_length += 8u * size;
@@ -606,8 +606,10 @@ static void ot_kmac_process(void *opaque)
         g_assert(fifo8_is_empty(&s->input_fifo));
 
         if (s->current_app->req_pending) {
-            sha3_process(&s->ltc_state, s->current_app->req.msg_data,
-                         s->current_app->req.msg_len);
+            const OtKMACAppReq *req = &s->current_app->req;
+            sha3_process(&s->ltc_state,
+                         req->msg_ptr ? req->msg_ptr : req->msg_data,
+                         req->msg_len);
             s->current_app->req_pending = false;
             if (s->current_app->req.last) {
                 /* go to PROCESSING state, response will be sent there */
@@ -623,9 +625,12 @@ static void ot_kmac_process(void *opaque)
     } else {
         /* SW mode, process FIFO data */
         if (!fifo8_is_empty(&s->input_fifo)) {
+            /* the FIFO may wrap, absorb it in at most two contiguous spans */
             while (!fifo8_is_empty(&s->input_fifo)) {
-                uint8_t value = fifo8_pop(&s->input_fifo);
-                sha3_process(&s->ltc_state, &value, 1);
+                uint32_t num;
+                uint32_t max = fifo8_num_used(&s->input_fifo);
+                const uint8_t *buf = fifo8_pop_buf(&s->input_fifo, max, &num);
+                sha3_process(&s->ltc_state, buf, num);
             }
 
             /* assert FIFO Empty interrupt */
@@ -249,8 +249,14 @@ static void ot_pwrmgr_rom_done(void *opaque, int irq, int level)
         if (good) {
             CPUState *cpu = ot_common_get_local_cpu(DEVICE(s));
             if (cpu) {
-                cpu->halted = 0;
-                cpu_resume(cpu);
+                /* start all the harts that share the local bus */
+                AddressSpace *as = cpu->as;
+                CPU_FOREACH(cpu) {
+                    if (cpu->as == as) {
+                        cpu->halted = 0;
+                        cpu_resume(cpu);
+                    }
+                }
             } else {
                 error_report("ot_pwrmgr: Could not find a vCPU to start!");
             }
@@ -129,7 +129,6 @@ struct OtRomCtrlState {
 
     bool first_reset;
     bool fake_digest;
-    hwaddr digest_offset;
 
     char *rom_id;
     uint32_t size;
@@ -310,15 +309,15 @@ static const MemoryRegionOps ot_rom_ctrl_regs_ops = {
 
 static void ot_rom_ctrl_send_kmac_req(OtRomCtrlState *s)
 {
-    OtKMACAppReq req;
-    uint8_t *rom_ptr = (uint8_t *)memory_region_get_ram_ptr(&s->mem);
-    size_t size = MIN(s->size - ROM_DIGEST_BYTES - s->digest_offset,
-                      OT_KMAC_APP_MSG_BYTES);
+    OtKMACAppReq req = { 0 };
 
-    memcpy(req.msg_data, rom_ptr + s->digest_offset, size);
-    req.msg_len = size;
-    req.last = s->digest_offset == (s->size - ROM_DIGEST_BYTES);
-    s->digest_offset += size;
+    /*
+     * Absorb the whole ROM, but the expected digest words at its end, in a
+     * single request: the ROM content is stable until the next reset.
+     */
+    req.msg_ptr = (const uint8_t *)memory_region_get_ram_ptr(&s->mem);
+    req.msg_len = s->size - ROM_DIGEST_BYTES;
+    req.last = true;
 
     ot_kmac_app_request(s->kmac, s->kmac_app, &req);
 }
@@ -328,9 +327,8 @@ ot_rom_ctrl_handle_kmac_response(void *opaque, const OtKMACAppRsp *rsp)
 {
     OtRomCtrlState *s = OT_ROM_CTRL(opaque);
 
+    /* the ROM is sent as a single last request, only the final reply counts */
     if (rsp->done) {
-        g_assert(s->digest_offset == (s->size - ROM_DIGEST_BYTES));
-
         /* switch to ROMD mode */
         memory_region_rom_device_set_romd(&s->mem, true);
 
@@ -351,8 +349,6 @@ ot_rom_ctrl_handle_kmac_response(void *opaque, const OtKMACAppRsp *rsp)
 
         /* compare digests and send notification */
         ot_rom_ctrl_compare_and_notify(s);
-    } else {
-        ot_rom_ctrl_send_kmac_req(s);
     }
 }
 
@@ -403,7 +399,6 @@ static void ot_rom_ctrl_reset_exit(Object *obj)
         s->first_reset = false;
 
         /* start computing ROM digest */
-        s->digest_offset = 0;
         ot_rom_ctrl_send_kmac_req(s);
     } else {
         /* only compare existing digests and send notification to pwrmgr */
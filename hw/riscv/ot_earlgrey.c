@@ -87,6 +87,12 @@ static void ot_earlgrey_soc_uart_configure(
 /* EarlGrey/CW310 AON clock is 250 kHz */
 #define OT_EARLGREY_AON_CLK_HZ 250000u
 
+/*
+ * EarlGrey has a single Ibex hart; more harts may be instantiated with -smp
+ * for multi-core prototypes.
+ */
+#define OT_EARLGREY_MAX_HARTS 4u
+
 enum OtEarlGreySocDevice {
     OT_EARLGREY_SOC_DEV_ADC_CTRL,
     OT_EARLGREY_SOC_DEV_AES,
@@ -861,6 +867,8 @@ struct OtEarlGreySoCState {
     SysBusDevice parent_obj;
 
     DeviceState **devices;
+    DeviceState **harts; /* harts[0] is also devices[OT_EARLGREY_SOC_DEV_HART] */
+    unsigned hart_count;
 };
 
 struct OtEarlGreyBoardState {
@@ -951,6 +959,9 @@ static void ot_earlgrey_soc_reset_hold(Object *obj)
                             RESET_TYPE_COLD);
 
     cpu_reset(CPU(s->devices[OT_EARLGREY_SOC_DEV_HART]));
+    for (unsigned ix = 1u; ix < s->hart_count; ix++) {
+        cpu_reset(CPU(s->harts[ix]));
+    }
 }
 
 static void ot_earlgrey_soc_reset_exit(Object *obj)
@@ -967,19 +978,87 @@ static void ot_earlgrey_soc_reset_exit(Object *obj)
                              RESET_TYPE_COLD);
 }
 
+static void ot_earlgrey_soc_realize_harts(OtEarlGreySoCState *s)
+{
+    const IbexDeviceDef *def =
+        &ot_earlgrey_soc_devices[OT_EARLGREY_SOC_DEV_HART];
+
+    s->harts[0] = s->devices[OT_EARLGREY_SOC_DEV_HART];
+
+    /* secondary harts share the configuration of the first one */
+    for (unsigned ix = 1u; ix < s->hart_count; ix++) {
+        DeviceState *hart = qdev_new(def->type);
+        char *name = g_strdup_printf("%s[%u]", def->type, ix);
+        object_property_add_child(OBJECT(s), name, OBJECT(hart));
+        g_free(name);
+
+        ibex_define_device_props(&hart, def, 1u);
+        RISCV_CPU(hart)->env.mhartid = ix;
+        ibex_realize_devices(&hart, NULL, def, 1u);
+        s->harts[ix] = hart;
+    }
+}
+
+static void ot_earlgrey_soc_connect_harts(OtEarlGreySoCState *s)
+{
+    DeviceState *plic = s->devices[OT_EARLGREY_SOC_DEV_PLIC];
+
+    if (s->hart_count == 1u) {
+        /* the device table already covers the single hart case */
+        return;
+    }
+
+    /*
+     * PLIC outputs are the S-mode lines of every hart followed by their
+     * M-mode lines. The device table routes output 1, i.e. the M-mode line
+     * of a single hart; with more harts it becomes an S-mode line, which is
+     * never raised as the harts only have M-mode contexts.
+     *
+     * The timer only serves hart 0, as on a real EarlGrey.
+     */
+    for (unsigned ix = 0; ix < s->hart_count; ix++) {
+        qdev_connect_gpio_out(plic, s->hart_count + ix,
+                              qdev_get_gpio_in(s->harts[ix], IRQ_M_EXT));
+    }
+}
+
 static void ot_earlgrey_soc_realize(DeviceState *dev, Error **errp)
 {
     OtEarlGreySoCState *s = RISCV_OT_EARLGREY_SOC(dev);
+    MachineState *ms = MACHINE(qdev_get_machine());
+    const IbexDeviceDef *defs = ot_earlgrey_soc_devices;
+    unsigned count = ARRAY_SIZE(ot_earlgrey_soc_devices);
+    unsigned next = OT_EARLGREY_SOC_DEV_HART + 1u;
+
+    s->hart_count = ms->smp.cpus;
+    s->harts = g_new0(DeviceState *, s->hart_count);
 
     /* Link, define properties and realize devices, then connect GPIOs */
-    ibex_link_devices(s->devices, ot_earlgrey_soc_devices,
-                      ARRAY_SIZE(ot_earlgrey_soc_devices));
-    ibex_define_device_props(s->devices, ot_earlgrey_soc_devices,
-                             ARRAY_SIZE(ot_earlgrey_soc_devices));
-    ibex_realize_system_devices(s->devices, ot_earlgrey_soc_devices,
-                                ARRAY_SIZE(ot_earlgrey_soc_devices));
-    ibex_connect_devices(s->devices, ot_earlgrey_soc_devices,
-                         ARRAY_SIZE(ot_earlgrey_soc_devices));
+    ibex_link_devices(s->devices, defs, count);
+    ibex_define_device_props(s->devices, defs, count);
+    if (s->hart_count > 1u) {
+        g_autoptr(GString) cfg = g_string_new("M");
+        for (unsigned ix = 1u; ix < s->hart_count; ix++) {
+            g_string_append(cfg, ",M");
+        }
+        object_property_set_str(OBJECT(s->devices[OT_EARLGREY_SOC_DEV_PLIC]),
+                                "hart-config", cfg->str, &error_fatal);
+    }
+
+    /*
+     * vCPU indices follow the realization order, and the PLIC looks up its
+     * harts by index: realize all the harts first.
+     */
+    ibex_realize_devices(s->devices, sysbus_get_default(), defs, next);
+    ot_earlgrey_soc_realize_harts(s);
+    ibex_realize_devices(&s->devices[next], sysbus_get_default(), &defs[next],
+                         count - next);
+
+    MemoryRegion *mrs[] = { get_system_memory(), NULL, NULL, NULL };
+    ibex_map_devices(s->devices, mrs, defs, count);
+
+    ibex_connect_devices(s->devices, defs, count);
+    ot_earlgrey_soc_connect_harts(s);
 
     /* load kernel if provided */
     ibex_load_kernel(NULL);
@@ -1130,7 +1209,7 @@ static void ot_earlgrey_machine_class_init(ObjectClass *oc, void *data)
 
     mc->desc = "RISC-V Board compatible with OpenTitan EarlGrey FPGA platform";
     mc->init = ot_earlgrey_machine_init;
-    mc->max_cpus = 1u;
+    mc->max_cpus = OT_EARLGREY_MAX_HARTS;
     mc->default_cpu_type =
         ot_earlgrey_soc_devices[OT_EARLGREY_SOC_DEV_HART].type;
     const IbexDeviceDef *sram =
@@ -60,4 +60,19 @@ extern const uint32_t AES_Te0[256], AES_Te1[256], AES_Te2[256],
 extern const uint32_t AES_Td0[256], AES_Td1[256], AES_Td2[256],
                       AES_Td3[256], AES_Td4[256];
 
+/*
+ * Single round primitives on a 16-byte state in the standard byte order
+ * (byte i is row i % 4 of column i / 4), without AddRoundKey.  They use
+ * the host AES instructions when aes_round_accel is true; @out may
+ * alias @in.
+ */
+extern bool aes_round_accel;
+
+/* SubBytes, ShiftRows and, if @mix, MixColumns */
+void aes_round_enc(uint8_t out[16], const uint8_t in[16], bool mix);
+/* InvShiftRows, InvSubBytes and, if @mix, InvMixColumns */
+void aes_round_dec(uint8_t out[16], const uint8_t in[16], bool mix);
+/* InvMixColumns */
+void aes_round_imc(uint8_t out[16], const uint8_t in[16]);
+
 #endif
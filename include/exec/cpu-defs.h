@@ -65,6 +65,9 @@
 /* use a fully associative victim tlb of 8 entries */
 #define CPU_VTLB_SIZE 8
 
+/* number of distinct large page regions tracked per mmu_idx */
+#define CPU_TLB_LARGE_PAGES 4
+
 #if HOST_LONG_BITS == 32 && TARGET_LONG_BITS == 32
 #define CPU_TLB_ENTRY_BITS 4
 #else
@@ -166,19 +169,28 @@ typedef struct CPUTLBEntryFull {
 #endif  /* !CONFIG_USER_ONLY */
 
 #if !defined(CONFIG_USER_ONLY) && defined(CONFIG_TCG)
+/*
+ * Describe a region covering one or more large pages allocated into
+ * the tlb.  A virtual address VA is within the region if
+ * (VA & mask) == addr.  An unused region has both fields set to -1.
+ */
+typedef struct CPUTLBLargePage {
+    target_ulong addr;
+    target_ulong mask;
+} CPUTLBLargePage;
+
 /*
  * Data elements that are per MMU mode, minus the bits accessed by
  * the TCG fast path.
  */
 typedef struct CPUTLBDesc {
     /*
-     * Describe a region covering all of the large pages allocated
-     * into the tlb.  When any page within this region is flushed,
-     * we must flush the entire tlb.  The region is matched if
-     * (addr & large_page_mask) == large_page_addr.
+     * The regions covering all of the large pages allocated into the
+     * tlb.  When any page within a region is flushed, every entry
+     * within that region must be flushed.  Large pages are merged into
+     * an existing region only once all slots are in use.
      */
-    target_ulong large_page_addr;
-    target_ulong large_page_mask;
+    CPUTLBLargePage large_page[CPU_TLB_LARGE_PAGES];
     /* host time (in ns) at the beginning of the time window */
     int64_t window_begin_ns;
     /* maximum number of entries observed in the window */
@@ -223,6 +235,10 @@ typedef struct CPUTLBCommon {
     size_t full_flush_count;
     size_t part_flush_count;
     size_t elide_flush_count;
+    size_t large_flush_count;
+    /* Fast path misses that were, or were not, resolved by the victim tlb. */
+    size_t vtlb_hit_count;
+    size_t vtlb_miss_count;
 } CPUTLBCommon;
 
 /*
@@ -373,6 +373,7 @@ struct CPUState {
     IcountDecr *icount_decr_ptr;
 
     CPUJumpCache *tb_jmp_cache;
+    TCGCPUStats *tcg_stats;
 
     struct GDBRegisterState *gdb_regs;
     int gdb_num_regs;
@@ -0,0 +1,52 @@
+/*
+ * QEMU OpenTitan AES block cipher engine
+ *
+ * Copyright (c) 2023 Rivos, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef HW_OPENTITAN_OT_CRYPTO_H
+#define HW_OPENTITAN_OT_CRYPTO_H
+
+#define OT_CRYPTO_AES_BLOCK_SIZE 16u
+
+typedef struct OtCryptoAES OtCryptoAES;
+
+OtCryptoAES *ot_crypto_aes_allocate(void);
+void ot_crypto_aes_release(OtCryptoAES *aes);
+
+/*
+ * Load a 128, 192 or 256-bit key. The key schedule is only rebuilt if the key
+ * differs from the one currently loaded.
+ */
+void ot_crypto_aes_set_key(OtCryptoAES *aes, const void *key, size_t key_len);
+/* Discard the current key, if any */
+void ot_crypto_aes_clear_key(OtCryptoAES *aes);
+
+/*
+ * Encrypt or decrypt in ECB mode, length should be a multiple of the AES block
+ * size. Input and output buffers may be the same.
+ */
+void ot_crypto_aes_encrypt(OtCryptoAES *aes, const void *in, void *out,
+                           size_t len);
+void ot_crypto_aes_decrypt(OtCryptoAES *aes, const void *in, void *out,
+                           size_t len);
+
+#endif /* HW_OPENTITAN_OT_CRYPTO_H */
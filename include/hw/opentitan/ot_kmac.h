@@ -69,6 +69,12 @@ typedef struct {
 
 typedef struct {
     uint8_t msg_data[OT_KMAC_APP_MSG_BYTES];
+    /*
+     * Optional bulk message: when not NULL, msg_len bytes are absorbed from
+     * this buffer rather than from msg_data. The buffer is not copied, it
+     * should remain valid until the response to this request is received.
+     */
+    const uint8_t *msg_ptr;
     size_t msg_len;
     bool last;
 } OtKMACAppReq;
@@ -514,6 +514,7 @@ static void rv32_lowrisc_ibex_cpu_init(Object *obj)
     cpu->cfg.ext_icboz = false;
     cpu->cfg.marchid = 0x16u;
     cpu->cfg.mtvec = 0x00000001u;
+    cpu->cfg.pmp_split_misaligned = true;
 #ifndef CONFIG_USER_ONLY
     set_satp_mode_max_supported(cpu, VM_1_10_MBARE);
 #endif
@@ -515,6 +515,8 @@ struct RISCVCPUConfig {
     bool mmu;
     bool pmp;
     bool epmp;
+    /* misaligned accesses are split, each part checked by PMP alone */
+    bool pmp_split_misaligned;
     bool debug;
     bool misa_w;
 
@@ -663,6 +665,8 @@ FIELD(TB_FLAGS, VTA, 24, 1)
 FIELD(TB_FLAGS, VMA, 25, 1)
 /* Native debug itrigger */
 FIELD(TB_FLAGS, ITRIGGER, 26, 1)
+/* Current privilege level, for CSR accesses checked at translate time */
+FIELD(TB_FLAGS, PRIV, 27, 2)
 
 #ifdef TARGET_RISCV32
 #define riscv_cpu_mxl(env)  ((void)(env), MXL_RV32)
@@ -808,6 +812,15 @@ typedef struct {
     riscv_csr_write128_fn write128;
     /* The default priv spec version should be PRIV_VERSION_1_10_0 (i.e 0) */
     uint32_t min_priv_ver;
+    /*
+     * Non-zero if the CSR is the target_ulong at this offset in
+     * CPURISCVState, its predicate accepts every privilege level allowed
+     * by the CSR number, and reading it has no side effects: the
+     * translator then loads it directly.  With inline_write, writes are
+     * plain stores too.
+     */
+    int inline_offset;
+    bool inline_write;
 } riscv_csr_operations;
 
 /* CSR function table constants */
@@ -108,6 +108,7 @@ void cpu_get_tb_cpu_state(CPURISCVState *env, target_ulong *pc,
     if (cpu->cfg.debug && !icount_enabled()) {
         flags = FIELD_DP32(flags, TB_FLAGS, ITRIGGER, env->itrigger_enabled);
     }
+    flags = FIELD_DP32(flags, TB_FLAGS, PRIV, env->priv);
 #endif
 
     flags = FIELD_DP32(flags, TB_FLAGS, XL, env->xl);
@@ -720,7 +721,7 @@ static int get_physical_address_pmp(CPURISCVState *env, int *prot,
 
     *prot = pmp_priv_to_page_prot(pmp_priv);
     if (tlb_size != NULL) {
-        *tlb_size = pmp_get_tlb_size(env, addr);
+        *tlb_size = pmp_get_tlb_size(env, addr, 1 << access_type, mode);
     }
 
     return TRANSLATE_SUCCESS;
@@ -146,6 +146,19 @@ static inline target_ulong aes64_operation(target_ulong rs1, target_ulong rs2,
     uint32_t col_0;
     uint32_t col_1;
 
+    if (aes_round_accel) {
+        uint8_t st[16];
+
+        stq_le_p(st, RS1);
+        stq_le_p(st + 8, RS2);
+        if (enc) {
+            aes_round_enc(st, st, mix);
+        } else {
+            aes_round_dec(st, st, mix);
+        }
+        return ldq_le_p(st);
+    }
+
     if (enc) {
         temp = AES_SHIFROWS_LO(RS1, RS2);
         temp = (((uint64_t)AES_sbox[(temp >> 0) & 0xFF] << 0) |
@@ -264,6 +277,14 @@ target_ulong HELPER(aes64im)(target_ulong rs1)
     uint32_t col_1 = RS1 >> 32;
     target_ulong result;
 
+    if (aes_round_accel) {
+        uint8_t st[16] = { };
+
+        stq_le_p(st, RS1);
+        aes_round_imc(st, st);
+        return ldq_le_p(st);
+    }
+
     col_0 = AES_INVMIXCOLUMN(col_0);
     col_1 = AES_INVMIXCOLUMN(col_1);
 
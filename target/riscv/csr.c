@@ -4071,7 +4071,8 @@ riscv_csr_operations csr_ops[CSR_TABLE_SIZE] = {
     [CSR_MVENDORID] = { "mvendorid", any,   read_mvendorid },
     [CSR_MARCHID]   = { "marchid",   any,   read_marchid   },
     [CSR_MIMPID]    = { "mimpid",    any,   read_mimpid    },
-    [CSR_MHARTID]   = { "mhartid",   any,   read_mhartid   },
+    [CSR_MHARTID]   = { "mhartid",   any,   read_mhartid,
+                        .inline_offset = offsetof(CPURISCVState, mhartid) },
 
     [CSR_MCONFIGPTR]  = { "mconfigptr", any,   read_zero,
                           .min_priv_ver = PRIV_VERSION_1_12_0 },
@@ -4083,7 +4084,8 @@ riscv_csr_operations csr_ops[CSR_TABLE_SIZE] = {
     [CSR_MIDELEG]     = { "mideleg",    any,   NULL, NULL,   rmw_mideleg   },
     [CSR_MEDELEG]     = { "medeleg",    any,   read_medeleg, write_medeleg },
     [CSR_MIE]         = { "mie",        any,   NULL, NULL,   rmw_mie       },
-    [CSR_MTVEC]       = { "mtvec",      any,   read_mtvec,   write_mtvec   },
+    [CSR_MTVEC]       = { "mtvec",      any,   read_mtvec,   write_mtvec,
+                          .inline_offset = offsetof(CPURISCVState, mtvec) },
     [CSR_MCOUNTEREN]  = { "mcounteren", umode, read_mcounteren,
                           write_mcounteren                                 },
 
@@ -4092,10 +4094,18 @@ riscv_csr_operations csr_ops[CSR_TABLE_SIZE] = {
 
     /* Machine Trap Handling */
     [CSR_MSCRATCH] = { "mscratch", any,  read_mscratch, write_mscratch,
-                       NULL, read_mscratch_i128, write_mscratch_i128   },
-    [CSR_MEPC]     = { "mepc",     any,  read_mepc,     write_mepc     },
-    [CSR_MCAUSE]   = { "mcause",   any,  read_mcause,   write_mcause   },
-    [CSR_MTVAL]    = { "mtval",    any,  read_mtval,    write_mtval    },
+                       NULL, read_mscratch_i128, write_mscratch_i128,
+                       .inline_offset = offsetof(CPURISCVState, mscratch),
+                       .inline_write = true },
+    [CSR_MEPC]     = { "mepc",     any,  read_mepc,     write_mepc,
+                       .inline_offset = offsetof(CPURISCVState, mepc),
+                       .inline_write = true },
+    [CSR_MCAUSE]   = { "mcause",   any,  read_mcause,   write_mcause,
+                       .inline_offset = offsetof(CPURISCVState, mcause),
+                       .inline_write = true },
+    [CSR_MTVAL]    = { "mtval",    any,  read_mtval,    write_mtval,
+                       .inline_offset = offsetof(CPURISCVState, mtval),
+                       .inline_write = true },
     [CSR_MIP]      = { "mip",      any,  NULL,    NULL, rmw_mip        },
 
     /* Machine-Level Window to Indirectly Accessed Registers (AIA) */
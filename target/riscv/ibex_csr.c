@@ -119,7 +119,8 @@ typedef struct {
 static riscv_custom_csr_operations csr_ibex_ops[] = {
     {
         .csrno = CSR_MTVEC,
-        .ops = { "mtvec", any, &read_mtvec, &write_mtvec },
+        .ops = { "mtvec", any, &read_mtvec, &write_mtvec,
+                 .inline_offset = offsetof(CPURISCVState, mtvec) },
     },
     {
         .csrno = CSR_CPUCTRLSTS,
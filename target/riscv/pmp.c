@@ -224,17 +224,59 @@ void pmp_update_rule_addr(CPURISCVState *env, uint32_t pmp_index)
     env->pmp_state.addr[pmp_index].ea = ea;
 }
 
+static int pmp_addr_cmp(const void *a, const void *b)
+{
+    target_ulong x = *(const target_ulong *)a;
+    target_ulong y = *(const target_ulong *)b;
+
+    return x < y ? -1 : x > y;
+}
+
+/*
+ * Count the active rules and flatten them into the segment table used by
+ * pmp_find_segment(): every rule boundary starts a new segment, and each
+ * segment records the highest priority (lowest numbered) rule matching it.
+ */
 void pmp_update_rule_nums(CPURISCVState *env)
 {
-    int i;
+    pmp_table_t *t = &env->pmp_state;
+    target_ulong points[PMP_MAX_SEGMENTS];
+    int i, j, n = 0;
 
-    env->pmp_state.num_rules = 0;
+    t->num_rules = 0;
+    points[n++] = 0;
     for (i = 0; i < MAX_RISCV_PMPS; i++) {
-        const uint8_t a_field =
-            pmp_get_a_field(env->pmp_state.pmp[i].cfg_reg);
+        const uint8_t a_field = pmp_get_a_field(t->pmp[i].cfg_reg);
         if (PMP_AMATCH_OFF != a_field) {
-            env->pmp_state.num_rules++;
+            t->num_rules++;
+            points[n++] = t->addr[i].sa;
+            if (t->addr[i].ea != (target_ulong)-1) {
+                points[n++] = t->addr[i].ea + 1;
+            }
+        }
+    }
+    qsort(points, n, sizeof(points[0]), pmp_addr_cmp);
+
+    t->num_segs = 0;
+    for (j = 0; j < n; j++) {
+        int rule = -1;
+
+        if (j > 0 && points[j] == points[j - 1]) {
+            continue;
+        }
+        for (i = 0; i < MAX_RISCV_PMPS; i++) {
+            if (pmp_get_a_field(t->pmp[i].cfg_reg) != PMP_AMATCH_OFF &&
+                points[j] >= t->addr[i].sa && points[j] <= t->addr[i].ea) {
+                rule = i;
+                break;
+            }
+        }
+        if (t->num_segs && t->seg_rule[t->num_segs - 1] == rule) {
+            continue;
         }
+        t->seg_start[t->num_segs] = points[j];
+        t->seg_rule[t->num_segs] = rule;
+        t->num_segs++;
     }
 }
 
@@ -319,6 +361,110 @@ static bool pmp_hart_has_privs_default(CPURISCVState *env, target_ulong addr,
 }
 
 
+/*
+ * Return the index of the segment containing @addr.
+ */
+static int pmp_find_segment(CPURISCVState *env, target_ulong addr)
+{
+    const pmp_table_t *t = &env->pmp_state;
+    int lo = 0, hi = t->num_segs - 1;
+
+    /* seg_start[0] is always 0, so the search cannot fail. */
+    while (lo < hi) {
+        int mid = (lo + hi + 1) / 2;
+
+        if (t->seg_start[mid] <= addr) {
+            lo = mid;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    return lo;
+}
+
+/*
+ * Return the privileges that PMP rule @pmp_index grants to @mode.
+ */
+static pmp_priv_t pmp_rule_privs(CPURISCVState *env, int pmp_index,
+                                 target_ulong mode)
+{
+    pmp_priv_t allowed_privs;
+    uint8_t epmp_operation;
+
+    if (!MSECCFG_MML_ISSET(env)) {
+        /*
+         * If mseccfg.MML Bit is not set, do pmp priv check
+         * This will always apply to regular PMP.
+         */
+        allowed_privs = PMP_READ | PMP_WRITE | PMP_EXEC;
+        if ((mode != PRV_M) || pmp_is_locked(env, pmp_index)) {
+            allowed_privs &= env->pmp_state.pmp[pmp_index].cfg_reg;
+        }
+        return allowed_privs;
+    }
+
+    /*
+     * If mseccfg.MML Bit set, do the enhanced pmp priv check
+     */
+    epmp_operation =
+        pmp_get_epmp_operation(env->pmp_state.pmp[pmp_index].cfg_reg);
+
+    if (mode == PRV_M) {
+        switch (epmp_operation) {
+        case 0:
+        case 1:
+        case 4:
+        case 5:
+        case 6:
+        case 7:
+        case 8:
+            return 0;
+        case 2:
+        case 3:
+        case 14:
+            return PMP_READ | PMP_WRITE;
+        case 9:
+        case 10:
+            return PMP_EXEC;
+        case 11:
+        case 13:
+            return PMP_READ | PMP_EXEC;
+        case 12:
+        case 15:
+            return PMP_READ;
+        default:
+            g_assert_not_reached();
+        }
+    } else {
+        switch (epmp_operation) {
+        case 0:
+        case 8:
+        case 9:
+        case 12:
+        case 13:
+        case 14:
+            return 0;
+        case 1:
+        case 10:
+        case 11:
+            return PMP_EXEC;
+        case 2:
+        case 4:
+        case 15:
+            return PMP_READ;
+        case 3:
+        case 6:
+            return PMP_READ | PMP_WRITE;
+        case 5:
+            return PMP_READ | PMP_EXEC;
+        case 7:
+            return PMP_READ | PMP_WRITE | PMP_EXEC;
+        default:
+            g_assert_not_reached();
+        }
+    }
+}
+
 /*
  * Public Interface
  */
@@ -333,11 +479,9 @@ int pmp_hart_has_privs(CPURISCVState *env, target_ulong addr,
     target_ulong size, pmp_priv_t privs, pmp_priv_t *allowed_privs,
     target_ulong mode)
 {
-    int i = 0;
     int ret = -1;
     int pmp_size = 0;
-    target_ulong s = 0;
-    target_ulong e = 0;
+    int s, e;
 
     /* Short cut if no rules */
     if (0 == pmp_get_num_rules(env)) {
@@ -345,6 +489,7 @@ int pmp_hart_has_privs(CPURISCVState *env, target_ulong addr,
                                        allowed_privs, mode)) {
             ret = MAX_RISCV_PMPS;
         }
+        return ret;
     }
 
     if (size == 0) {
@@ -361,120 +506,26 @@ int pmp_hart_has_privs(CPURISCVState *env, target_ulong addr,
         pmp_size = size;
     }
 
-    /* 1.10 draft priv spec states there is an implicit order
-         from low to high */
-    for (i = 0; i < MAX_RISCV_PMPS; i++) {
-        s = pmp_is_in_range(env, i, addr);
-        e = pmp_is_in_range(env, i, addr + pmp_size - 1);
+    /*
+     * 1.10 draft priv spec states there is an implicit order from low to
+     * high; the segment table already resolves it.  The first rule that
+     * matches either end of the access must match both of them.
+     */
+    s = env->pmp_state.seg_rule[pmp_find_segment(env, addr)];
+    e = env->pmp_state.seg_rule[pmp_find_segment(env, addr + pmp_size - 1)];
 
+    if (s != e) {
         /* partially inside */
-        if ((s + e) == 1) {
-            qemu_log_mask(LOG_GUEST_ERROR,
-                          "pmp violation - access is partially inside\n");
-            ret = -1;
-            break;
-        }
-
-        /* fully inside */
-        const uint8_t a_field =
-            pmp_get_a_field(env->pmp_state.pmp[i].cfg_reg);
-
-        if (((s + e) == 2) && (PMP_AMATCH_OFF != a_field)) {
-            /*
-             * If the PMP entry is not off and the address is in range,
-             * do the priv check
-             */
-            if (!MSECCFG_MML_ISSET(env)) {
-                /*
-                 * If mseccfg.MML Bit is not set, do pmp priv check
-                 * This will always apply to regular PMP.
-                 */
-                *allowed_privs = PMP_READ | PMP_WRITE | PMP_EXEC;
-                if ((mode != PRV_M) || pmp_is_locked(env, i)) {
-                    *allowed_privs &= env->pmp_state.pmp[i].cfg_reg;
-                }
-            } else {
-                /*
-                 * If mseccfg.MML Bit set, do the enhanced pmp priv check
-                 */
-                const uint8_t epmp_operation =
-                    pmp_get_epmp_operation(env->pmp_state.pmp[i].cfg_reg);
-
-                if (mode == PRV_M) {
-                    switch (epmp_operation) {
-                    case 0:
-                    case 1:
-                    case 4:
-                    case 5:
-                    case 6:
-                    case 7:
-                    case 8:
-                        *allowed_privs = 0;
-                        break;
-                    case 2:
-                    case 3:
-                    case 14:
-                        *allowed_privs = PMP_READ | PMP_WRITE;
-                        break;
-                    case 9:
-                    case 10:
-                        *allowed_privs = PMP_EXEC;
-                        break;
-                    case 11:
-                    case 13:
-                        *allowed_privs = PMP_READ | PMP_EXEC;
-                        break;
-                    case 12:
-                    case 15:
-                        *allowed_privs = PMP_READ;
-                        break;
-                    default:
-                        g_assert_not_reached();
-                    }
-                } else {
-                    switch (epmp_operation) {
-                    case 0:
-                    case 8:
-                    case 9:
-                    case 12:
-                    case 13:
-                    case 14:
-                        *allowed_privs = 0;
-                        break;
-                    case 1:
-                    case 10:
-                    case 11:
-                        *allowed_privs = PMP_EXEC;
-                        break;
-                    case 2:
-                    case 4:
-                    case 15:
-                        *allowed_privs = PMP_READ;
-                        break;
-                    case 3:
-                    case 6:
-                        *allowed_privs = PMP_READ | PMP_WRITE;
-                        break;
-                    case 5:
-                        *allowed_privs = PMP_READ | PMP_EXEC;
-                        break;
-                    case 7:
-                        *allowed_privs = PMP_READ | PMP_WRITE | PMP_EXEC;
-                        break;
-                    default:
-                        g_assert_not_reached();
-                    }
-                }
-            }
-
-            /*
-             * If matching address range was found, the protection bits
-             * defined with PMP must be used. We shouldn't fallback on
-             * finding default privileges.
-             */
-            ret = i;
-            break;
-        }
+        qemu_log_mask(LOG_GUEST_ERROR,
+                      "pmp violation - access is partially inside\n");
+    } else if (s >= 0) {
+        /*
+         * If matching address range was found, the protection bits
+         * defined with PMP must be used. We shouldn't fallback on
+         * finding default privileges.
+         */
+        *allowed_privs = pmp_rule_privs(env, s, mode);
+        ret = s;
     }
 
     /* No rule matched */
@@ -630,15 +681,22 @@ target_ulong mseccfg_csr_read(CPURISCVState *env)
  * A write access to 0x80000000 will match PMP1. However we cannot cache the
  * translation result in the TLB since this will make the write access to
  * 0x80000008 bypass the check of PMP0.
- * To avoid this we return a size of 1 (which means no caching) if the PMP
- * region only covers partial of the TLB page.
+ * To avoid this we return a size of 1 (which means no caching) if the
+ * TLB page is split by PMP regions.  On CPUs that split misaligned
+ * accesses and check each part on its own (pmp_split_misaligned), pages
+ * that are split uniformly (e.g. RX code next to another RX rule) are
+ * cached: an access straddling two such rules is allowed there anyway.
+ * Elsewhere the priv spec requires such an access to fail, which only
+ * the uncached check can tell.
  */
-target_ulong pmp_get_tlb_size(CPURISCVState *env, target_ulong addr)
+target_ulong pmp_get_tlb_size(CPURISCVState *env, target_ulong addr,
+                              pmp_priv_t privs, target_ulong mode)
 {
-    target_ulong pmp_sa;
-    target_ulong pmp_ea;
+    const pmp_table_t *t = &env->pmp_state;
     target_ulong tlb_sa = addr & ~(TARGET_PAGE_SIZE - 1);
     target_ulong tlb_ea = tlb_sa + TARGET_PAGE_SIZE - 1;
+    bool split = riscv_cpu_cfg(env)->pmp_split_misaligned;
+    pmp_priv_t page_privs = 0, seg_privs;
     int i;
 
     /*
@@ -650,37 +708,21 @@ target_ulong pmp_get_tlb_size(CPURISCVState *env, target_ulong addr)
         return TARGET_PAGE_SIZE;
     }
 
-    for (i = 0; i < MAX_RISCV_PMPS; i++) {
-        if (pmp_get_a_field(env->pmp_state.pmp[i].cfg_reg) == PMP_AMATCH_OFF) {
-            continue;
+    for (i = pmp_find_segment(env, tlb_sa);
+         i < t->num_segs && t->seg_start[i] <= tlb_ea; i++) {
+        if (t->seg_rule[i] >= 0) {
+            seg_privs = pmp_rule_privs(env, t->seg_rule[i], mode);
+        } else {
+            pmp_hart_has_privs_default(env, tlb_sa, 0, privs, &seg_privs,
+                                       mode);
         }
-
-        pmp_sa = env->pmp_state.addr[i].sa;
-        pmp_ea = env->pmp_state.addr[i].ea;
-
-        /*
-         * Only the first PMP entry that covers (whole or partial of) the TLB
-         * page really matters:
-         * If it covers the whole TLB page, set the size to TARGET_PAGE_SIZE,
-         * since the following PMP entries have lower priority and will not
-         * affect the permissions of the page.
-         * If it only covers partial of the TLB page, set the size to 1 since
-         * the allowed permissions of the region may be different from other
-         * region of the page.
-         */
-        if (pmp_sa <= tlb_sa && pmp_ea >= tlb_ea) {
-            return TARGET_PAGE_SIZE;
-        } else if ((pmp_sa >= tlb_sa && pmp_sa <= tlb_ea) ||
-                   (pmp_ea >= tlb_sa && pmp_ea <= tlb_ea)) {
+        if (t->seg_start[i] > tlb_sa &&
+            (!split || seg_privs != page_privs)) {
             return 1;
         }
+        page_privs = seg_privs;
     }
 
-    /*
-     * If no PMP entry matches the TLB page, the TLB page will also not be
-     * split into regions with different permissions by PMP so we set the size
-     * to TARGET_PAGE_SIZE.
-     */
     return TARGET_PAGE_SIZE;
 }
 
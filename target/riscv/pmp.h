@@ -56,10 +56,21 @@ typedef struct {
     target_ulong ea;
 } pmp_addr_t;
 
+/* Every rule adds at most two boundaries to the segment table. */
+#define PMP_MAX_SEGMENTS (2 * MAX_RISCV_PMPS + 1)
+
 typedef struct {
     pmp_entry_t pmp[MAX_RISCV_PMPS];
     pmp_addr_t  addr[MAX_RISCV_PMPS];
     uint32_t num_rules;
+    /*
+     * The active rules flattened into sorted, non-overlapping segments:
+     * segment i starts at seg_start[i] and is matched by rule seg_rule[i],
+     * or by no rule if negative.  Rebuilt by pmp_update_rule_nums().
+     */
+    target_ulong seg_start[PMP_MAX_SEGMENTS];
+    int8_t seg_rule[PMP_MAX_SEGMENTS];
+    int num_segs;
 } pmp_table_t;
 
 void pmpcfg_csr_write(CPURISCVState *env, uint32_t reg_index,
@@ -76,7 +87,8 @@ int pmp_hart_has_privs(CPURISCVState *env, target_ulong addr,
                        target_ulong size, pmp_priv_t privs,
                        pmp_priv_t *allowed_privs,
                        target_ulong mode);
-target_ulong pmp_get_tlb_size(CPURISCVState *env, target_ulong addr);
+target_ulong pmp_get_tlb_size(CPURISCVState *env, target_ulong addr,
+                              pmp_priv_t privs, target_ulong mode);
 void pmp_update_rule_addr(CPURISCVState *env, uint32_t pmp_index);
 void pmp_update_rule_nums(CPURISCVState *env);
 uint32_t pmp_get_num_rules(CPURISCVState *env);
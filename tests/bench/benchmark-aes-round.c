@@ -0,0 +1,235 @@
+/*
+ * AES single round primitives speed benchmark
+ *
+ * Compares the host AES instructions, when available, with the portable
+ * implementation used by the TCG crypto helpers, after checking both
+ * against the FIPS-197 example and the AES_Te/AES_Td table rounds.
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or
+ * (at your option) any later version.  See the COPYING file in the
+ * top-level directory.
+ */
+#include "qemu/osdep.h"
+#include "crypto/aes.h"
+
+#define ROUNDS (16 * 1024 * 1024)
+
+typedef struct AESRoundOpts {
+    const char *name;
+    bool accel;
+    bool dec;
+    bool mix;
+} AESRoundOpts;
+
+static void test_aes_round_speed(const void *opaque)
+{
+    const AESRoundOpts *opts = opaque;
+    bool saved = aes_round_accel;
+    uint8_t st[16];
+    int i;
+
+    for (i = 0; i < 16; i++) {
+        st[i] = g_test_rand_int();
+    }
+
+    aes_round_accel = opts->accel;
+    g_test_timer_start();
+    for (i = 0; i < ROUNDS; i++) {
+        if (opts->dec) {
+            aes_round_dec(st, st, opts->mix);
+        } else {
+            aes_round_enc(st, st, opts->mix);
+        }
+    }
+    g_test_timer_elapsed();
+    aes_round_accel = saved;
+
+    g_test_message("%s (%s): %.2f Mrounds/sec", opts->name,
+                   opts->accel ? "host" : "portable",
+                   ROUNDS / g_test_timer_last() / 1e6);
+}
+
+/* Operations 0-1: enc without/with mix, 2-3: dec, 4: imc */
+static void aes_round_op(int op, uint8_t out[16], const uint8_t in[16])
+{
+    if (op < 2) {
+        aes_round_enc(out, in, op & 1);
+    } else if (op < 4) {
+        aes_round_dec(out, in, op & 1);
+    } else {
+        aes_round_imc(out, in);
+    }
+}
+
+/*
+ * Reference rounds built on the AES_Te and AES_Td tables used by the
+ * block cipher.  Byte 4 * c + r of the state is row r of column c.
+ */
+static void aes_round_ref(int op, uint8_t out[16], const uint8_t in[16])
+{
+    static const uint32_t *const te[4] = { AES_Te0, AES_Te1, AES_Te2, AES_Te3 };
+    static const uint32_t *const td[4] = { AES_Td0, AES_Td1, AES_Td2, AES_Td3 };
+    uint8_t t[16];
+    int c, r;
+
+    for (c = 0; c < 4; c++) {
+        uint32_t w = 0;
+
+        for (r = 0; r < 4; r++) {
+            uint8_t enc = in[4 * ((c + r) & 3) + r];
+            uint8_t dec = in[4 * ((c - r) & 3) + r];
+
+            switch (op) {
+            case 0:
+                w |= (uint32_t)AES_sbox[enc] << (24 - 8 * r);
+                break;
+            case 1:
+                w ^= te[r][enc];
+                break;
+            case 2:
+                w |= (uint32_t)AES_isbox[dec] << (24 - 8 * r);
+                break;
+            case 3:
+                w ^= td[r][dec];
+                break;
+            default:
+                /* Td applies the inverse S-box first, so undo it */
+                w ^= td[r][AES_sbox[in[4 * c + r]]];
+                break;
+            }
+        }
+        for (r = 0; r < 4; r++) {
+            t[4 * c + r] = w >> (24 - 8 * r);
+        }
+    }
+    memcpy(out, t, 16);
+}
+
+/* Round 1 of the FIPS-197 appendix B cipher example, by column. */
+static const uint8_t fips197_start[16] = {
+    0x19, 0x3d, 0xe3, 0xbe, 0xa0, 0xf4, 0xe2, 0x2b,
+    0x9a, 0xc6, 0x8d, 0x2a, 0xe9, 0xf8, 0x48, 0x08,
+};
+static const uint8_t fips197_shift_rows[16] = {
+    0xd4, 0xbf, 0x5d, 0x30, 0xe0, 0xb4, 0x52, 0xae,
+    0xb8, 0x41, 0x11, 0xf1, 0x1e, 0x27, 0x98, 0xe5,
+};
+static const uint8_t fips197_mix_columns[16] = {
+    0x04, 0x66, 0x81, 0xe5, 0xe0, 0xcb, 0x19, 0x9a,
+    0x48, 0xf8, 0xd3, 0x7a, 0x28, 0x06, 0x26, 0x4c,
+};
+
+static void test_aes_round_kat(const void *opaque)
+{
+    bool saved = aes_round_accel;
+    uint8_t out[16];
+
+    if (*(const bool *)opaque && !saved) {
+        g_test_skip("no host AES instructions");
+        return;
+    }
+
+    aes_round_accel = *(const bool *)opaque;
+    aes_round_enc(out, fips197_start, false);
+    g_assert_cmpmem(out, 16, fips197_shift_rows, 16);
+    aes_round_enc(out, fips197_start, true);
+    g_assert_cmpmem(out, 16, fips197_mix_columns, 16);
+    aes_round_dec(out, fips197_shift_rows, false);
+    g_assert_cmpmem(out, 16, fips197_start, 16);
+    aes_round_imc(out, fips197_mix_columns);
+    g_assert_cmpmem(out, 16, fips197_shift_rows, 16);
+    aes_round_accel = saved;
+}
+
+static void test_aes_round_tables(const void *opaque)
+{
+    bool saved = aes_round_accel;
+    uint8_t in[16], ref[16], out[16];
+    int i, n, op;
+
+    if (*(const bool *)opaque && !saved) {
+        g_test_skip("no host AES instructions");
+        return;
+    }
+
+    aes_round_accel = *(const bool *)opaque;
+    for (n = 0; n < 1000; n++) {
+        for (i = 0; i < 16; i++) {
+            in[i] = g_test_rand_int();
+        }
+        for (op = 0; op < 5; op++) {
+            aes_round_ref(op, ref, in);
+            aes_round_op(op, out, in);
+            g_assert_cmpmem(ref, 16, out, 16);
+        }
+    }
+    aes_round_accel = saved;
+}
+
+static void test_aes_round_match(void)
+{
+    bool saved = aes_round_accel;
+    uint8_t in[16], ref[16], out[16];
+    int i, n, op;
+
+    if (!saved) {
+        g_test_skip("no host AES instructions");
+        return;
+    }
+
+    for (n = 0; n < 1000; n++) {
+        for (i = 0; i < 16; i++) {
+            in[i] = g_test_rand_int();
+        }
+        for (op = 0; op < 5; op++) {
+            aes_round_accel = false;
+            aes_round_op(op, ref, in);
+            aes_round_accel = true;
+            aes_round_op(op, out, in);
+            g_assert_cmpmem(ref, 16, out, 16);
+        }
+    }
+    aes_round_accel = saved;
+}
+
+int main(int argc, char **argv)
+{
+    static const AESRoundOpts opts[] = {
+        { "enc", false, false, false },
+        { "enc-mix", false, false, true },
+        { "dec", false, true, false },
+        { "dec-mix", false, true, true },
+        { "enc", true, false, false },
+        { "enc-mix", true, false, true },
+        { "dec", true, true, false },
+        { "dec-mix", true, true, true },
+    };
+    static const bool paths[] = { false, true };
+    char name[64];
+    int i;
+
+    g_test_init(&argc, &argv, NULL);
+
+    for (i = 0; i < ARRAY_SIZE(paths); i++) {
+        const char *path = paths[i] ? "host" : "portable";
+
+        snprintf(name, sizeof(name), "/crypto/benchmark/aes-round/%s/kat",
+                 path);
+        g_test_add_data_func(name, &paths[i], test_aes_round_kat);
+        snprintf(name, sizeof(name), "/crypto/benchmark/aes-round/%s/tables",
+                 path);
+        g_test_add_data_func(name, &paths[i], test_aes_round_tables);
+    }
+    g_test_add_func("/crypto/benchmark/aes-round/match",
+                    test_aes_round_match);
+    for (i = 0; i < ARRAY_SIZE(opts); i++) {
+        if (opts[i].accel && !aes_round_accel) {
+            continue;
+        }
+        snprintf(name, sizeof(name), "/crypto/benchmark/aes-round/%s/%s",
+                 opts[i].accel ? "host" : "portable", opts[i].name);
+        g_test_add_data_func(name, &opts[i], test_aes_round_speed);
+    }
+
+    return g_test_run();
+}
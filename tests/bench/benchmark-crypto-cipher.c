@@ -14,6 +14,7 @@
 #include "qemu/units.h"
 #include "crypto/init.h"
 #include "crypto/cipher.h"
+#include "qapi/error.h"
 
 static void test_cipher_speed(size_t chunk_size,
                               QCryptoCipherMode mode,
@@ -165,6 +166,70 @@ static void test_cipher_speed_xts_aes_256(const void *opaque)
 }
 
 
+/*
+ * Small requests with frequent key changes, as done by the device models
+ * (e.g. CTR_DRBG re-keys after every few blocks): compare a new key schedule
+ * for each request with a reused one.
+ */
+static void test_cipher_speed_rekey(const void *opaque)
+{
+    size_t blocks = (size_t)opaque;
+    size_t chunk_size = blocks * 16;
+    /* whole chunks only, so that the loops below end */
+    const size_t total = QEMU_ALIGN_DOWN(64 * MiB, chunk_size);
+    uint8_t key[32], *plaintext, *ciphertext;
+    QCryptoCipher *cipher;
+    size_t remain;
+
+    if (!qcrypto_cipher_supports(QCRYPTO_CIPHER_ALG_AES_256,
+                                 QCRYPTO_CIPHER_MODE_ECB)) {
+        return;
+    }
+
+    memset(key, g_test_rand_int(), sizeof(key));
+    plaintext = g_new0(uint8_t, chunk_size);
+    ciphertext = g_new0(uint8_t, chunk_size);
+    memset(plaintext, g_test_rand_int(), chunk_size);
+
+    g_test_timer_start();
+    remain = total;
+    while (remain) {
+        cipher = qcrypto_cipher_new(QCRYPTO_CIPHER_ALG_AES_256,
+                                    QCRYPTO_CIPHER_MODE_ECB,
+                                    key, sizeof(key), &error_abort);
+        g_assert(qcrypto_cipher_encrypt(cipher, plaintext, ciphertext,
+                                        chunk_size, &error_abort) == 0);
+        qcrypto_cipher_free(cipher);
+        /* next key derives from the output, as CTR_DRBG update does */
+        key[0] ^= ciphertext[0];
+        remain -= chunk_size;
+    }
+    g_test_timer_elapsed();
+
+    g_test_message("enc(aes-256-ecb) new key every %zu blocks %.2f MB/sec ",
+                   blocks, (double)total / MiB / g_test_timer_last());
+
+    cipher = qcrypto_cipher_new(QCRYPTO_CIPHER_ALG_AES_256,
+                                QCRYPTO_CIPHER_MODE_ECB,
+                                key, sizeof(key), &error_abort);
+    g_test_timer_start();
+    remain = total;
+    while (remain) {
+        g_assert(qcrypto_cipher_encrypt(cipher, plaintext, ciphertext,
+                                        chunk_size, &error_abort) == 0);
+        remain -= chunk_size;
+    }
+    g_test_timer_elapsed();
+    qcrypto_cipher_free(cipher);
+
+    g_test_message("enc(aes-256-ecb) same key, %zu blocks %.2f MB/sec ",
+                   blocks, (double)total / MiB / g_test_timer_last());
+
+    g_free(plaintext);
+    g_free(ciphertext);
+}
+
+
 int main(int argc, char **argv)
 {
     char *alg = NULL;
@@ -204,5 +269,12 @@ int main(int argc, char **argv)
     ADD_TESTS(16384);
     ADD_TESTS(65536);
 
+    if (!alg || g_str_equal(alg, "rekey")) {
+        g_test_add_data_func("/crypto/cipher/rekey-aes-256/blocks-1",
+                             (void *)1, test_cipher_speed_rekey);
+        g_test_add_data_func("/crypto/cipher/rekey-aes-256/blocks-3",
+                             (void *)3, test_cipher_speed_rekey);
+    }
+
     return g_test_run();
 }
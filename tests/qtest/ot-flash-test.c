@@ -0,0 +1,405 @@
+/*
+ * QTest testcase for the OpenTitan flash controller
+ *
+ * Programs and erases data and info pages, checks the memory protection,
+ * program window and program type errors, and that the modified pages are
+ * written back to a writable flash image.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "qemu/osdep.h"
+#include "qemu/bitops.h"
+#include "qemu/bswap.h"
+#include "libqtest.h"
+
+#define FLASH_BASE              0x41000000u
+#define FLASH_MEM_BASE          0x20000000u
+
+#define FLASH_CONTROL           0x20u
+#define  FLASH_CONTROL_START    BIT(0)
+#define  FLASH_CONTROL_OP_READ  (0u << 4)
+#define  FLASH_CONTROL_OP_PROG  (1u << 4)
+#define  FLASH_CONTROL_OP_ERASE (2u << 4)
+#define  FLASH_CONTROL_BANK_ERASE BIT(7)
+#define  FLASH_CONTROL_INFO     BIT(8)
+#define  FLASH_CONTROL_INFO_SEL(_s_) ((_s_) << 9)
+#define  FLASH_CONTROL_NUM(_n_) (((_n_) - 1u) << 16)
+#define FLASH_ADDR              0x24u
+#define FLASH_PROG_TYPE_EN      0x28u
+#define FLASH_MP_REGION_CFG_0   0x50u
+#define FLASH_MP_REGION_0       0x70u
+#define FLASH_DEFAULT_REGION    0x90u
+#define FLASH_BANK0_INFO0_PAGE_CFG_0 0xbcu
+#define FLASH_BANK1_INFO0_PAGE_CFG_0 0x124u
+#define FLASH_MP_BANK_CFG       0x16cu
+#define FLASH_OP_STATUS         0x170u
+#define  FLASH_OP_STATUS_DONE   BIT(0)
+#define  FLASH_OP_STATUS_ERR    BIT(1)
+#define FLASH_ERR_CODE          0x17cu
+#define  FLASH_ERR_MP           BIT(1)
+#define  FLASH_ERR_PROG_WIN     BIT(4)
+#define  FLASH_ERR_PROG_TYPE    BIT(5)
+#define FLASH_PROG_FIFO         0x1b0u
+#define FLASH_RD_FIFO           0x1b4u
+
+/* multi-bit booleans, one nibble per field */
+#define MB4_TRUE                0x6u
+#define MB4_FALSE               0x9u
+/* MP_REGION_CFG and INFO_PAGE_CFG: EN, RD, PROG, ERASE, then 3 more */
+#define MP_CFG(_en_, _rd_, _prog_, _erase_) \
+    (0x9990000u | ((_erase_) << 12) | ((_prog_) << 8) | ((_rd_) << 4) | (_en_))
+/* DEFAULT_REGION has no EN field: RD, PROG, ERASE, then 3 more */
+#define DEFAULT_CFG(_rd_, _prog_, _erase_) \
+    (0x999000u | ((_erase_) << 8) | ((_prog_) << 4) | (_rd_))
+
+#define PAGE_SIZE_BYTES         0x800u
+#define BANK_SIZE               0x80000u
+#define BANK_COUNT              2u
+#define INFO_PAGES              (10u + 1u + 2u)
+#define INFO_BANK_SIZE          (INFO_PAGES * PAGE_SIZE_BYTES)
+
+/* backend image: header, data partitions, info partitions, ELF names */
+#define IMG_HEADER_SIZE         32u
+#define IMG_INFO_OFFSET         (IMG_HEADER_SIZE + BANK_COUNT * BANK_SIZE)
+#define IMG_TRAILER_SIZE        (BANK_COUNT * 2u * 256u)
+#define IMG_SIZE \
+    (IMG_INFO_OFFSET + BANK_COUNT * INFO_BANK_SIZE + IMG_TRAILER_SIZE)
+
+static uint32_t flash_readl(QTestState *qts, uint32_t reg)
+{
+    return qtest_readl(qts, FLASH_BASE + reg);
+}
+
+static void flash_writel(QTestState *qts, uint32_t reg, uint32_t val)
+{
+    qtest_writel(qts, FLASH_BASE + reg, val);
+}
+
+static void flash_start(QTestState *qts, uint32_t ctrl, uint32_t addr,
+                        unsigned count)
+{
+    /* clear the status of the previous operation */
+    flash_writel(qts, FLASH_OP_STATUS, 0);
+    flash_writel(qts, FLASH_ERR_CODE, 0);
+    flash_writel(qts, FLASH_ADDR, addr);
+    flash_writel(qts, FLASH_CONTROL,
+                 FLASH_CONTROL_START | ctrl | FLASH_CONTROL_NUM(count));
+}
+
+/* Return the error code of the completed operation, 0 on success */
+static uint32_t flash_result(QTestState *qts)
+{
+    uint32_t status = flash_readl(qts, FLASH_OP_STATUS);
+
+    g_assert_true(status & FLASH_OP_STATUS_DONE);
+    if (!(status & FLASH_OP_STATUS_ERR)) {
+        return 0;
+    }
+    return flash_readl(qts, FLASH_ERR_CODE);
+}
+
+static uint32_t flash_program(QTestState *qts, uint32_t info, uint32_t addr,
+                              const uint32_t *words, unsigned count)
+{
+    flash_start(qts, FLASH_CONTROL_OP_PROG | info, addr, count);
+    if (flash_readl(qts, FLASH_OP_STATUS) & FLASH_OP_STATUS_DONE) {
+        /* rejected before any word is pushed */
+        return flash_result(qts);
+    }
+    for (unsigned ix = 0; ix < count; ix++) {
+        flash_writel(qts, FLASH_PROG_FIFO, words[ix]);
+    }
+    return flash_result(qts);
+}
+
+static uint32_t flash_erase(QTestState *qts, uint32_t ctrl, uint32_t addr)
+{
+    flash_start(qts, FLASH_CONTROL_OP_ERASE | ctrl, addr, 1u);
+    return flash_result(qts);
+}
+
+static void flash_read(QTestState *qts, uint32_t info, uint32_t addr,
+                       uint32_t *words, unsigned count)
+{
+    flash_start(qts, FLASH_CONTROL_OP_READ | info, addr, count);
+    for (unsigned ix = 0; ix < count; ix++) {
+        words[ix] = flash_readl(qts, FLASH_RD_FIFO);
+    }
+    g_assert_cmphex(flash_result(qts), ==, 0);
+}
+
+static void check_data(QTestState *qts, uint32_t addr, const uint32_t *words,
+                       unsigned count)
+{
+    uint32_t buf[16u];
+
+    g_assert(count <= ARRAY_SIZE(buf));
+    flash_read(qts, 0, addr, buf, count);
+    for (unsigned ix = 0; ix < count; ix++) {
+        g_assert_cmphex(buf[ix], ==, words[ix]);
+        /* code and data are also read straight from the ROM device */
+        g_assert_cmphex(qtest_readl(qts, FLASH_MEM_BASE + addr + ix * 4u), ==,
+                        words[ix]);
+    }
+}
+
+static void check_info(QTestState *qts, uint32_t info, uint32_t addr,
+                       const uint32_t *words, unsigned count)
+{
+    uint32_t buf[16u];
+
+    g_assert(count <= ARRAY_SIZE(buf));
+    flash_read(qts, info, addr, buf, count);
+    for (unsigned ix = 0; ix < count; ix++) {
+        g_assert_cmphex(buf[ix], ==, words[ix]);
+    }
+}
+
+static void check_erased(QTestState *qts, uint32_t info, uint32_t addr)
+{
+    uint32_t buf[16u];
+
+    flash_read(qts, info, addr, buf, ARRAY_SIZE(buf));
+    for (unsigned ix = 0; ix < ARRAY_SIZE(buf); ix++) {
+        g_assert_cmphex(buf[ix], ==, UINT32_MAX);
+    }
+}
+
+static void make_words(uint32_t *words, unsigned count, uint32_t seed)
+{
+    for (unsigned ix = 0; ix < count; ix++) {
+        words[ix] = seed ^ (ix * 0x01010101u);
+    }
+}
+
+static void test_data_pages(void)
+{
+    QTestState *qts = qtest_init("-M ot-earlgrey");
+    uint32_t words[16u], mask[16u];
+    const uint32_t addr = 2u * PAGE_SIZE_BYTES;
+
+    make_words(words, ARRAY_SIZE(words), 0xc0de0000u);
+
+    /* everything is denied out of reset */
+    g_assert_cmphex(flash_program(qts, 0, addr, words, ARRAY_SIZE(words)), ==,
+                    FLASH_ERR_MP);
+    g_assert_cmphex(flash_erase(qts, 0, addr), ==, FLASH_ERR_MP);
+
+    flash_writel(qts, FLASH_DEFAULT_REGION,
+                 DEFAULT_CFG(MB4_TRUE, MB4_TRUE, MB4_TRUE));
+    g_assert_cmphex(flash_program(qts, 0, addr, words, ARRAY_SIZE(words)), ==,
+                    0);
+    check_data(qts, addr, words, ARRAY_SIZE(words));
+
+    /* programming can only clear bits */
+    for (unsigned ix = 0; ix < ARRAY_SIZE(mask); ix++) {
+        mask[ix] = 0x0f0f0f0fu;
+    }
+    g_assert_cmphex(flash_program(qts, 0, addr, mask, ARRAY_SIZE(mask)), ==, 0);
+    for (unsigned ix = 0; ix < ARRAY_SIZE(mask); ix++) {
+        mask[ix] &= words[ix];
+    }
+    check_data(qts, addr, mask, ARRAY_SIZE(mask));
+
+    /* a program operation cannot cross a 64-byte program window */
+    g_assert_cmphex(flash_program(qts, 0, addr + 0x3cu, words, 2u), ==,
+                    FLASH_ERR_PROG_WIN);
+
+    /* the first matching region overrides the default region */
+    flash_writel(qts, FLASH_MP_REGION_0, (1u << 9) | (addr / PAGE_SIZE_BYTES));
+    flash_writel(qts, FLASH_MP_REGION_CFG_0,
+                 MP_CFG(MB4_TRUE, MB4_TRUE, MB4_FALSE, MB4_FALSE));
+    g_assert_cmphex(flash_program(qts, 0, addr, words, 1u), ==, FLASH_ERR_MP);
+    g_assert_cmphex(flash_erase(qts, 0, addr), ==, FLASH_ERR_MP);
+    /* the next page is not in the region */
+    g_assert_cmphex(flash_program(qts, 0, addr + PAGE_SIZE_BYTES, words, 1u),
+                    ==, 0);
+    check_data(qts, addr, mask, ARRAY_SIZE(mask));
+
+    flash_writel(qts, FLASH_MP_REGION_CFG_0,
+                 MP_CFG(MB4_FALSE, MB4_FALSE, MB4_FALSE, MB4_FALSE));
+    g_assert_cmphex(flash_erase(qts, 0, addr), ==, 0);
+    check_erased(qts, 0, addr);
+    g_assert_cmphex(qtest_readl(qts, FLASH_MEM_BASE + addr), ==, UINT32_MAX);
+
+    /* bank erase is only allowed by MP_BANK_CFG */
+    g_assert_cmphex(flash_program(qts, 0, BANK_SIZE, words, 4u), ==, 0);
+    g_assert_cmphex(flash_erase(qts, FLASH_CONTROL_BANK_ERASE, BANK_SIZE), ==,
+                    FLASH_ERR_MP);
+    check_data(qts, BANK_SIZE, words, 4u);
+    flash_writel(qts, FLASH_MP_BANK_CFG, BIT(1));
+    g_assert_cmphex(flash_erase(qts, FLASH_CONTROL_BANK_ERASE, BANK_SIZE), ==,
+                    0);
+    check_erased(qts, 0, BANK_SIZE);
+    /* the other bank is left alone */
+    check_data(qts, addr + PAGE_SIZE_BYTES, words, 1u);
+
+    qtest_quit(qts);
+}
+
+static void test_info_pages(void)
+{
+    QTestState *qts = qtest_init("-M ot-earlgrey");
+    const uint32_t info = FLASH_CONTROL_INFO | FLASH_CONTROL_INFO_SEL(0);
+    /* bank 1, info partition 0, page 1 */
+    const uint32_t addr = BANK_SIZE + PAGE_SIZE_BYTES;
+    uint32_t words[16u];
+
+    make_words(words, ARRAY_SIZE(words), 0x1f0a0000u);
+
+    /* the default region does not apply to info pages */
+    flash_writel(qts, FLASH_DEFAULT_REGION,
+                 DEFAULT_CFG(MB4_TRUE, MB4_TRUE, MB4_TRUE));
+    g_assert_cmphex(flash_program(qts, info, addr, words, ARRAY_SIZE(words)),
+                    ==, FLASH_ERR_MP);
+    g_assert_cmphex(flash_erase(qts, info, addr), ==, FLASH_ERR_MP);
+
+    /* a page that is not enabled is denied, even with PROG_EN */
+    flash_writel(qts, FLASH_BANK1_INFO0_PAGE_CFG_0 + 4u,
+                 MP_CFG(MB4_FALSE, MB4_TRUE, MB4_TRUE, MB4_TRUE));
+    g_assert_cmphex(flash_program(qts, info, addr, words, ARRAY_SIZE(words)),
+                    ==, FLASH_ERR_MP);
+
+    flash_writel(qts, FLASH_BANK1_INFO0_PAGE_CFG_0 + 4u,
+                 MP_CFG(MB4_TRUE, MB4_TRUE, MB4_TRUE, MB4_TRUE));
+    g_assert_cmphex(flash_program(qts, info, addr, words, ARRAY_SIZE(words)),
+                    ==, 0);
+    check_info(qts, info, addr, words, ARRAY_SIZE(words));
+    /* the data partition at the same address is untouched */
+    check_erased(qts, 0, addr);
+    /* neither is the same page of the other bank */
+    check_erased(qts, info, PAGE_SIZE_BYTES);
+
+    g_assert_cmphex(flash_erase(qts, info, addr), ==, 0);
+    check_erased(qts, info, addr);
+
+    qtest_quit(qts);
+}
+
+static void test_prog_type(void)
+{
+    QTestState *qts = qtest_init("-M ot-earlgrey");
+    uint32_t word = 0x12345678u;
+
+    flash_writel(qts, FLASH_DEFAULT_REGION,
+                 DEFAULT_CFG(MB4_TRUE, MB4_TRUE, MB4_TRUE));
+
+    /* PROG_TYPE_EN bits can be cleared, but not set back */
+    g_assert_cmphex(flash_readl(qts, FLASH_PROG_TYPE_EN), ==, 0x3u);
+    flash_writel(qts, FLASH_PROG_TYPE_EN, 0x2u);
+    g_assert_cmphex(flash_readl(qts, FLASH_PROG_TYPE_EN), ==, 0x2u);
+    flash_writel(qts, FLASH_PROG_TYPE_EN, 0x3u);
+    g_assert_cmphex(flash_readl(qts, FLASH_PROG_TYPE_EN), ==, 0x2u);
+
+    g_assert_cmphex(flash_program(qts, 0, 0, &word, 1u), ==,
+                    FLASH_ERR_PROG_TYPE);
+    check_erased(qts, 0, 0);
+
+    qtest_quit(qts);
+}
+
+static char *create_image(void)
+{
+    g_autofree uint8_t *img = g_malloc(IMG_SIZE);
+    char *path;
+    int fd;
+
+    memset(img, 0xff, IMG_SIZE - IMG_TRAILER_SIZE);
+    /* no ELF file names */
+    memset(&img[IMG_SIZE - IMG_TRAILER_SIZE], 0, IMG_TRAILER_SIZE);
+
+    memset(img, 0, IMG_HEADER_SIZE);
+    memcpy(img, "vFSH", 4u);
+    stl_le_p(&img[4], IMG_HEADER_SIZE - 8u); /* header length */
+    stl_le_p(&img[8], 1u); /* version */
+    img[12] = BANK_COUNT;
+    img[13] = 3u; /* info partitions per bank */
+    stw_le_p(&img[14], BANK_SIZE / PAGE_SIZE_BYTES);
+    stl_le_p(&img[16], PAGE_SIZE_BYTES);
+    img[20] = 10u; /* pages per info partition */
+    img[21] = 1u;
+    img[22] = 2u;
+
+    fd = g_file_open_tmp("qtest-ot-flash-XXXXXX", &path, NULL);
+    g_assert(fd >= 0);
+    g_assert_cmpint(write(fd, img, IMG_SIZE), ==, IMG_SIZE);
+    close(fd);
+
+    return path;
+}
+
+static void check_image(const char *path, uint32_t offset,
+                        const uint32_t *words, unsigned count)
+{
+    g_autofree char *img = NULL;
+    size_t len;
+
+    g_assert_true(g_file_get_contents(path, &img, &len, NULL));
+    g_assert_cmpuint(len, ==, IMG_SIZE);
+    for (unsigned ix = 0; ix < count; ix++) {
+        g_assert_cmphex(ldl_le_p(&img[offset + ix * 4u]), ==,
+                        words ? words[ix] : UINT32_MAX);
+    }
+}
+
+static void test_persistence(void)
+{
+    g_autofree char *path = create_image();
+    const uint32_t info = FLASH_CONTROL_INFO | FLASH_CONTROL_INFO_SEL(0);
+    /* bank 0, data page 5, and info partition 0, page 4 */
+    const uint32_t data_addr = 5u * PAGE_SIZE_BYTES;
+    const uint32_t info_addr = 4u * PAGE_SIZE_BYTES;
+    const uint32_t info_offset = IMG_INFO_OFFSET + info_addr;
+    uint32_t words[16u];
+    QTestState *qts;
+
+    make_words(words, ARRAY_SIZE(words), 0xfeed0000u);
+
+    qts = qtest_initf("-M ot-earlgrey "
+                      "-drive if=mtd,bus=1,file=%s,format=raw", path);
+    flash_writel(qts, FLASH_DEFAULT_REGION,
+                 DEFAULT_CFG(MB4_TRUE, MB4_TRUE, MB4_TRUE));
+    flash_writel(qts, FLASH_BANK0_INFO0_PAGE_CFG_0 + 4u * 4u,
+                 MP_CFG(MB4_TRUE, MB4_TRUE, MB4_TRUE, MB4_TRUE));
+    g_assert_cmphex(flash_program(qts, 0, data_addr, words, ARRAY_SIZE(words)),
+                    ==, 0);
+    g_assert_cmphex(flash_program(qts, info, info_addr, words,
+                                  ARRAY_SIZE(words)), ==, 0);
+    qtest_quit(qts);
+
+    /* pages are written back as each operation completes */
+    check_image(path, IMG_HEADER_SIZE + data_addr, words, ARRAY_SIZE(words));
+    check_image(path, info_offset, words, ARRAY_SIZE(words));
+    /* the rest of the pages is left as it was */
+    check_image(path, IMG_HEADER_SIZE + data_addr + 64u, NULL, 16u);
+    check_image(path, IMG_HEADER_SIZE + data_addr - 64u, NULL, 16u);
+
+    /* a new run starts from the programmed image */
+    qts = qtest_initf("-M ot-earlgrey "
+                      "-drive if=mtd,bus=1,file=%s,format=raw", path);
+    check_data(qts, data_addr, words, ARRAY_SIZE(words));
+    check_info(qts, info, info_addr, words, ARRAY_SIZE(words));
+
+    flash_writel(qts, FLASH_DEFAULT_REGION,
+                 DEFAULT_CFG(MB4_TRUE, MB4_TRUE, MB4_TRUE));
+    g_assert_cmphex(flash_erase(qts, 0, data_addr), ==, 0);
+    qtest_quit(qts);
+
+    check_image(path, IMG_HEADER_SIZE + data_addr, NULL, ARRAY_SIZE(words));
+    check_image(path, info_offset, words, ARRAY_SIZE(words));
+
+    unlink(path);
+}
+
+int main(int argc, char **argv)
+{
+    g_test_init(&argc, &argv, NULL);
+
+    qtest_add_func("ot-flash/data-pages", test_data_pages);
+    qtest_add_func("ot-flash/info-pages", test_info_pages);
+    qtest_add_func("ot-flash/prog-type", test_prog_type);
+    qtest_add_func("ot-flash/persistence", test_persistence);
+
+    return g_test_run();
+}
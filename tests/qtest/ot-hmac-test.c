@@ -0,0 +1,167 @@
+/*
+ * QTest testcase for the OpenTitan HMAC accelerator
+ *
+ * Checks the SHA-256 and HMAC-SHA256 digests against GLib, and reports
+ * the throughput of the message FIFO in performance mode (-m perf).
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "qemu/osdep.h"
+#include "qemu/bitops.h"
+#include "qemu/bswap.h"
+#include "qemu/units.h"
+#include "libqtest.h"
+
+#define HMAC_BASE               0x41110000u
+
+#define HMAC_INTR_STATE         0x00u
+#define  HMAC_INTR_HMAC_DONE    BIT(0)
+#define HMAC_CFG                0x10u
+#define  HMAC_CFG_HMAC_EN       BIT(0)
+#define  HMAC_CFG_SHA_EN        BIT(1)
+#define HMAC_CMD                0x14u
+#define  HMAC_CMD_HASH_START    BIT(0)
+#define  HMAC_CMD_HASH_PROCESS  BIT(1)
+#define HMAC_KEY_0              0x24u
+#define HMAC_DIGEST_0           0x44u
+#define HMAC_FIFO               0x800u
+#define HMAC_FIFO_SIZE          0x800u
+
+#define SHA256_DIGEST_SIZE      32u
+#define BENCH_SIZE              (1u * MiB)
+
+static void hmac_start(QTestState *qts, bool hmac, const uint8_t *key)
+{
+    if (hmac) {
+        for (unsigned ix = 0; ix < SHA256_DIGEST_SIZE / 4u; ix++) {
+            /* keys are big-endian words, as for the digest */
+            qtest_writel(qts, HMAC_BASE + HMAC_KEY_0 + ix * 4u,
+                         ldl_be_p(&key[ix * 4u]));
+        }
+    }
+    qtest_writel(qts, HMAC_BASE + HMAC_CFG,
+                 HMAC_CFG_SHA_EN | (hmac ? HMAC_CFG_HMAC_EN : 0));
+    qtest_writel(qts, HMAC_BASE + HMAC_CMD, HMAC_CMD_HASH_START);
+}
+
+static void hmac_push(QTestState *qts, const uint8_t *buf, size_t len)
+{
+    /* every write to the FIFO window is appended to the message */
+    while (len) {
+        size_t chunk = MIN(len, HMAC_FIFO_SIZE);
+        qtest_memwrite(qts, HMAC_BASE + HMAC_FIFO, buf, chunk);
+        buf += chunk;
+        len -= chunk;
+    }
+}
+
+static void hmac_finish(QTestState *qts, uint8_t *digest)
+{
+    qtest_writel(qts, HMAC_BASE + HMAC_CMD, HMAC_CMD_HASH_PROCESS);
+    qtest_clock_step(qts, 1000);
+    g_assert_true(qtest_readl(qts, HMAC_BASE + HMAC_INTR_STATE) &
+                  HMAC_INTR_HMAC_DONE);
+    qtest_writel(qts, HMAC_BASE + HMAC_INTR_STATE, HMAC_INTR_HMAC_DONE);
+
+    for (unsigned ix = 0; ix < SHA256_DIGEST_SIZE / 4u; ix++) {
+        stl_be_p(&digest[ix * 4u],
+                 qtest_readl(qts, HMAC_BASE + HMAC_DIGEST_0 + ix * 4u));
+    }
+}
+
+static void check_digest(const uint8_t *digest, const char *expected)
+{
+    g_autofree char *hex = g_malloc(SHA256_DIGEST_SIZE * 2u + 1u);
+
+    for (unsigned ix = 0; ix < SHA256_DIGEST_SIZE; ix++) {
+        sprintf(&hex[ix * 2u], "%02x", digest[ix]);
+    }
+    g_assert_cmpstr(hex, ==, expected);
+}
+
+static uint8_t *make_message(size_t len)
+{
+    uint8_t *buf = g_malloc(len);
+
+    for (size_t ix = 0; ix < len; ix++) {
+        buf[ix] = (uint8_t)(ix * 7u + (ix >> 8));
+    }
+    return buf;
+}
+
+static void test_sha256(void)
+{
+    QTestState *qts = qtest_init("-M ot-earlgrey");
+    const size_t sizes[] = { 0, 3, 63, 64, 65, 1000, 4099 };
+    uint8_t digest[SHA256_DIGEST_SIZE];
+
+    for (unsigned ix = 0; ix < ARRAY_SIZE(sizes); ix++) {
+        g_autofree uint8_t *msg = make_message(sizes[ix]);
+        g_autofree char *expected =
+            g_compute_checksum_for_data(G_CHECKSUM_SHA256, msg, sizes[ix]);
+
+        hmac_start(qts, false, NULL);
+        hmac_push(qts, msg, sizes[ix]);
+        hmac_finish(qts, digest);
+        check_digest(digest, expected);
+    }
+
+    qtest_quit(qts);
+}
+
+static void test_hmac_sha256(void)
+{
+    QTestState *qts = qtest_init("-M ot-earlgrey");
+    g_autofree uint8_t *msg = make_message(1000);
+    uint8_t key[SHA256_DIGEST_SIZE];
+    uint8_t digest[SHA256_DIGEST_SIZE];
+
+    for (unsigned ix = 0; ix < sizeof(key); ix++) {
+        key[ix] = 0xa0u + ix;
+    }
+
+    g_autofree char *expected = g_compute_hmac_for_data(
+        G_CHECKSUM_SHA256, key, sizeof(key), msg, 1000);
+
+    hmac_start(qts, true, key);
+    hmac_push(qts, msg, 1000);
+    hmac_finish(qts, digest);
+    check_digest(digest, expected);
+
+    qtest_quit(qts);
+}
+
+static void test_sha256_speed(void)
+{
+    QTestState *qts = qtest_init("-M ot-earlgrey");
+    g_autofree uint8_t *msg = make_message(BENCH_SIZE);
+    g_autofree char *expected =
+        g_compute_checksum_for_data(G_CHECKSUM_SHA256, msg, BENCH_SIZE);
+    uint8_t digest[SHA256_DIGEST_SIZE];
+
+    g_test_timer_start();
+    hmac_start(qts, false, NULL);
+    hmac_push(qts, msg, BENCH_SIZE);
+    hmac_finish(qts, digest);
+    g_test_timer_elapsed();
+
+    check_digest(digest, expected);
+    g_test_message("sha256: %.2f MiB/s",
+                   BENCH_SIZE / g_test_timer_last() / MiB);
+
+    qtest_quit(qts);
+}
+
+int main(int argc, char **argv)
+{
+    g_test_init(&argc, &argv, NULL);
+
+    qtest_add_func("ot-hmac/sha256", test_sha256);
+    qtest_add_func("ot-hmac/hmac-sha256", test_hmac_sha256);
+    if (g_test_perf()) {
+        qtest_add_func("ot-hmac/sha256-speed", test_sha256_speed);
+    }
+
+    return g_test_run();
+}
@@ -0,0 +1,134 @@
+/*
+ * QTest testcase for TCG invalidation of code overwritten by DMA
+ *
+ * The guest loops on a TB that starts at offset 0 of a page, and the
+ * test then rewrites that code with a single write that starts in the
+ * previous page.  The guest must pick up the new code.
+ *
+ * Writes to the same page that miss the translated bytes must not
+ * disturb the running code, nor hide a later write over that code.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "qemu/osdep.h"
+#include "qemu/bswap.h"
+#include "libqtest.h"
+
+#define RAM_BASE        0x80000000u
+#define GUEST_PAGE_SIZE 0x1000u
+#define CODE_ADDR       (RAM_BASE + GUEST_PAGE_SIZE)
+#define MARK_ADDR       (RAM_BASE + 2u * GUEST_PAGE_SIZE)
+/* the rewrite starts near the end of the page before the code */
+#define WRITE_ADDR      (CODE_ADDR - 0x100u)
+/* data that shares the code page, well away from the translated bytes */
+#define DATA_ADDR       (CODE_ADDR + 0x800u)
+
+static const uint32_t entry_rv64[] = {
+    0x0000106fu,    /* j      CODE_ADDR */
+};
+
+static const uint32_t code_rv64[2][4] = {
+    {
+        0x00001297u,    /* 1: auipc  t0, 1     t0 = MARK_ADDR */
+        0x00100313u,    /*    li     t1, 1 */
+        0x0062a023u,    /*    sw     t1, 0(t0) */
+        0xff5ff06fu,    /*    j      1b */
+    }, {
+        0x00001297u,    /* 1: auipc  t0, 1 */
+        0x00200313u,    /*    li     t1, 2 */
+        0x0062a023u,    /*    sw     t1, 0(t0) */
+        0xff5ff06fu,    /*    j      1b */
+    },
+};
+
+static void wait_mark(QTestState *qts, uint32_t mark)
+{
+    for (unsigned ix = 0; ix < 1000u; ix++) {
+        if (qtest_readl(qts, MARK_ADDR) == mark) {
+            return;
+        }
+        g_usleep(10000);
+    }
+    g_assert_cmphex(qtest_readl(qts, MARK_ADDR), ==, mark);
+}
+
+static void write_code(QTestState *qts, const uint32_t *code, size_t size)
+{
+    /* a single write covering the tail of one page and all of the next */
+    size_t len = MARK_ADDR - WRITE_ADDR;
+    g_autofree uint8_t *buf = g_malloc0(len);
+
+    for (unsigned ix = 0; ix < size / sizeof(uint32_t); ix++) {
+        stl_le_p(&buf[CODE_ADDR - WRITE_ADDR + ix * 4u], code[ix]);
+    }
+    qtest_memwrite(qts, WRITE_ADDR, buf, len);
+}
+
+static void write_words(QTestState *qts, uint64_t addr,
+                        const uint32_t *words, size_t size)
+{
+    g_autofree uint8_t *buf = g_malloc(size);
+
+    for (unsigned ix = 0; ix < size / sizeof(uint32_t); ix++) {
+        stl_le_p(&buf[ix * 4u], words[ix]);
+    }
+    qtest_memwrite(qts, addr, buf, size);
+}
+
+static QTestState *start_loop(void)
+{
+    QTestState *qts = qtest_init("-M virt -bios none -S -accel tcg");
+
+    write_words(qts, RAM_BASE, entry_rv64, sizeof(entry_rv64));
+    write_code(qts, code_rv64[0], sizeof(code_rv64[0]));
+    qtest_qmp_assert_success(qts, "{ 'execute': 'cont' }");
+    wait_mark(qts, 1);
+
+    return qts;
+}
+
+static void test_rewrite_next_page(void)
+{
+    QTestState *qts = start_loop();
+
+    write_code(qts, code_rv64[1], sizeof(code_rv64[1]));
+    wait_mark(qts, 2);
+
+    qtest_quit(qts);
+}
+
+static void test_write_near_code(void)
+{
+    static const uint32_t data[] = {
+        0xdeadbeefu, 0x01234567u, 0x89abcdefu, 0xcafef00du,
+    };
+    QTestState *qts = start_loop();
+
+    write_words(qts, DATA_ADDR, data, sizeof(data));
+    for (unsigned ix = 0; ix < ARRAY_SIZE(data); ix++) {
+        g_assert_cmphex(qtest_readl(qts, DATA_ADDR + ix * 4u), ==, data[ix]);
+    }
+
+    /* the loop still runs the original code */
+    qtest_writel(qts, MARK_ADDR, 0);
+    wait_mark(qts, 1);
+
+    /* and a write over the code itself is still picked up */
+    write_words(qts, CODE_ADDR, code_rv64[1], sizeof(code_rv64[1]));
+    wait_mark(qts, 2);
+
+    qtest_quit(qts);
+}
+
+int main(int argc, char **argv)
+{
+    g_test_init(&argc, &argv, NULL);
+
+    if (qtest_has_machine("virt")) {
+        qtest_add_func("tcg-smc/rewrite-next-page", test_rewrite_next_page);
+        qtest_add_func("tcg-smc/write-near-code", test_write_near_code);
+    }
+
+    return g_test_run();
+}